@@ -6,9 +6,15 @@
 #include "renderer/shader.hpp"
 #include "renderer/mesh.hpp"
 #include "renderer/camera.hpp"
+#include "renderer/tube.hpp"
 #include "pdb/model.hpp"
+#include "pdb/atom_table.hpp"
+#include "pdb/cache.hpp"
+#include "pdb/selection.hpp"
+#include "pdb/writer.hpp"
 #include <vector>
 #include <iostream>
+#include <filesystem>
 #include "utils/fileio.hpp"
 #include "physics/unfold.hpp"
 
@@ -33,95 +39,10 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
         g_camera->ProcessMouseMovement(xoffset, yoffset);
 }
 
-// Helper functions for model to mesh conversion
-std::vector<glm::vec3> getCAPositions(const pdb::Model &model)
-{
-    std::vector<glm::vec3> ca_positions;
-    for (const auto &chain : model.chains)
-    {
-        for (const auto &res : chain->residues)
-        {
-            for (const auto &atom : res->atoms)
-            {
-                if (atom->name == "CA")
-                {
-                    ca_positions.push_back(glm::vec3(atom->x, atom->y, atom->z));
-                }
-            }
-        }
-    }
-    return ca_positions;
-}
-
-std::vector<Vertex> generateTubeVertices(const std::vector<glm::vec3> &ca_positions, int segments, float radius, float maxDistance)
-{
-    std::vector<Vertex> vertices;
-    for (size_t i = 0; i < ca_positions.size(); ++i)
-    {
-        glm::vec3 p = ca_positions[i];
-        glm::vec3 dir;
-        if (i == 0)
-            dir = glm::normalize(ca_positions[i + 1] - p);
-        else if (i == ca_positions.size() - 1)
-            dir = glm::normalize(p - ca_positions[i - 1]);
-        else
-            dir = glm::normalize(ca_positions[i + 1] - ca_positions[i - 1]);
-
-        glm::vec3 up = glm::vec3(0, 1, 0);
-        if (fabs(glm::dot(dir, up)) > 0.99f)
-            up = glm::vec3(1, 0, 0);
-        glm::vec3 right = glm::normalize(glm::cross(dir, up));
-        glm::vec3 normal = glm::normalize(glm::cross(right, dir));
-
-        for (int j = 0; j < segments; ++j)
-        {
-            float theta = 2.0f * 3.1415926f * float(j) / float(segments);
-            glm::vec3 circ = (right * cosf(theta) * radius) + (normal * sinf(theta) * radius);
-            Vertex v;
-            v.Position = p + circ;
-            v.Normal = glm::normalize(circ);
-            vertices.push_back(v);
-        }
-    }
-    return vertices;
-}
-
-std::vector<std::vector<unsigned int>> generateTubeIndices(const std::vector<glm::vec3> &ca_positions, int segments, float maxDistance)
-{
-    std::vector<std::vector<unsigned int>> indices(1);
-    int k = 0;
-    for (size_t i = 1; i < ca_positions.size(); ++i)
-    {
-        float dist = glm::distance(ca_positions[i], ca_positions[i - 1]);
-        if (dist > maxDistance)
-        {
-            indices.push_back(std::vector<unsigned int>());
-            k++;
-            continue;
-        }
-        for (int j = 0; j < segments; ++j)
-        {
-            int curr = (i - 1) * segments + j;
-            int next = i * segments + j;
-            int curr_next = (i - 1) * segments + (j + 1) % segments;
-            int next_next = i * segments + (j + 1) % segments;
-
-            indices[k].push_back(curr);
-            indices[k].push_back(next);
-            indices[k].push_back(curr_next);
-
-            indices[k].push_back(curr_next);
-            indices[k].push_back(next);
-            indices[k].push_back(next_next);
-        }
-    }
-    return indices;
-}
-
 std::vector<Mesh> modelToMesh(const pdb::Model &model)
 {
     std::vector<glm::vec3> ca_positions = getCAPositions(model);
-    std::vector<Vertex> vertices = generateTubeVertices(ca_positions, 12, 1.0f, 4.5f);
+    std::vector<Vertex> vertices = generateTubeVertices(ca_positions, 12, 1.0f);
     std::vector<std::vector<unsigned int>> indices = generateTubeIndices(ca_positions, 12, 4.5f);
 
     std::vector<Mesh> meshes;
@@ -145,6 +66,10 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 bool unfoldingActive = false;
 bool unfoldKeyPrev = false;
 
+// Snapshot request flag, set on 'P' key press
+bool snapshotRequested = false;
+bool snapshotKeyPrev = false;
+
 void processInput(GLFWwindow *window, Camera &camera, float deltaTime)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -168,6 +93,13 @@ void processInput(GLFWwindow *window, Camera &camera, float deltaTime)
         unfoldingActive = !unfoldingActive;
     }
     unfoldKeyPrev = unfoldKey;
+
+    // Save the current conformation on 'P' key press (not hold)
+    bool snapshotKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (snapshotKey && !snapshotKeyPrev) {
+        snapshotRequested = true;
+    }
+    snapshotKeyPrev = snapshotKey;
 }
 
 void setShaderUniforms(Shader &shader, Camera &camera, glm::vec3 lightPos)
@@ -220,28 +152,45 @@ int main(int argc, char **argv)
     // Load PDB
     if (argc < 2)
     {
-        std::cerr << "Usage: " << argv[0] << " <pdb_file>\n";
+        std::cerr << "Usage: " << argv[0] << " <structure_file> [selection]\n";
         return 1;
     }
 
-    std::ifstream pdbFile(argv[1]);
-    if (!pdbFile)
+    // Only the CA trace is rendered and simulated; skip everything else.
+    // Repeat loads of the same file come from the binary model cache.
+    auto model = pdb::loadCached(argv[1], pdb::ReaderOptions::caTrace());
+    if (!model)
     {
-        std::cerr << "Error: could not open file " << argv[1] << "\n";
+        std::cerr << "Error: failed to read PDB file " << argv[1] << std::endl;
         return 1;
     }
-    pdb::Reader reader(pdbFile);
-    auto model = reader.read();
-    if (!model)
+
+    // Optional selection, e.g. "chain A and resseq 10-80": everything else
+    // is dropped before rendering and simulation
+    if (argc > 2)
     {
-        std::cerr << "Error: failed to read PDB file" << std::endl;
-        return 1;
+        std::string error;
+        auto selector = pdb::Selector::compile(argv[2], &error);
+        if (!selector)
+        {
+            std::cerr << "Error: bad selection '" << argv[2] << "': " << error << std::endl;
+            return 1;
+        }
+        model->removeAtoms(~selector->select(pdb::AtomTable(*model)));
     }
     std::cout << "Atoms: " << model->atoms.size() << " Connections: " << model->connections.size() << std::endl;
 
     // Build unfolding simulation on CA trace
     UnfoldSim sim(*model);
 
+    // Snapshots go to <input>_unfold.pdb as one MODEL per key press
+    std::filesystem::path inputName = std::filesystem::path(argv[1]).filename();
+    if (inputName.extension() == ".gz")
+        inputName = inputName.stem();
+    std::string snapshotPath = inputName.stem().string() + "_unfold.pdb";
+    std::unique_ptr<pdb::Writer> snapshots;
+    std::vector<pdb::Point> snapshotFrame = pdb::positionsOf(*model);
+
     // Initial mesh from CA positions
     std::vector<Mesh> cube = modelToMesh(*model);
 
@@ -269,15 +218,17 @@ int main(int argc, char **argv)
         meshColors.push_back(color);
     }
 
-    // Compute model center
+    // Compute model center over the contiguous coordinate columns
+    pdb::AtomTable atomTable(*model);
+    size_t polymerAtoms = model->atoms.size();
     glm::vec3 center(0.0f);
-    if (!model->atoms.empty())
+    if (polymerAtoms > 0)
     {
-        for (const auto &atom : model->atoms)
+        for (size_t i = 0; i < polymerAtoms; ++i)
         {
-            center += glm::vec3(atom->x, atom->y, atom->z);
+            center += glm::vec3(atomTable.x[i], atomTable.y[i], atomTable.z[i]);
         }
-        center /= static_cast<float>(model->atoms.size());
+        center /= static_cast<float>(polymerAtoms);
     }
 
     glm::vec3 lightPos = center + glm::vec3(1.2f, 1.0f, 2.0f);
@@ -285,10 +236,10 @@ int main(int argc, char **argv)
 
     // Camera: start at a distance that fits the model
     float modelRadius = 50.0f;
-    if (!model->atoms.empty()) {
+    if (polymerAtoms > 0) {
         float maxDist = 0.0f;
-        for (const auto &atom : model->atoms) {
-            float d = glm::distance(center, glm::vec3(atom->x, atom->y, atom->z));
+        for (size_t i = 0; i < polymerAtoms; ++i) {
+            float d = glm::distance(center, glm::vec3(atomTable.x[i], atomTable.y[i], atomTable.z[i]));
             if (d > maxDist) maxDist = d;
         }
         modelRadius = maxDist;
@@ -326,7 +277,19 @@ int main(int argc, char **argv)
 
         // Update mesh vertices from current CA positions
         std::vector<glm::vec3> ca_positions = sim.getCAPositions();
-        std::vector<Vertex> vertices = generateTubeVertices(ca_positions, 12, 1.0f, 4.5f);
+
+        if (snapshotRequested)
+        {
+            snapshotRequested = false;
+            if (!snapshots)
+                snapshots = std::make_unique<pdb::Writer>(snapshotPath);
+            sim.copyPositions(snapshotFrame);
+            if (snapshots->write(*model, snapshotFrame))
+                std::cout << "Saved snapshot " << snapshots->models() << " to " << snapshotPath << std::endl;
+            else
+                std::cerr << "Error: failed to write " << snapshotPath << std::endl;
+        }
+        std::vector<Vertex> vertices = generateTubeVertices(ca_positions, 12, 1.0f);
         for (auto& m : cube) m.UpdateVertices(vertices);
 
 
@@ -0,0 +1,242 @@
+#include "pdb/archive.hpp"
+#include "pdb/cache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+
+namespace pdb {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'G', 'L', 'A'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrder = 0x01020304;
+
+static_assert(std::is_trivially_copyable<ChainSummary>::value, "ChainSummary is stored as raw bytes");
+static_assert(sizeof(ArchiveEntry) % 8 == 0 && sizeof(ChainSummary) % 8 == 0,
+              "Index records keep 8-byte alignment");
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t entrySize;
+    uint64_t entryCount;
+    uint64_t indexOffset;   // ArchiveEntry[entryCount], sorted by ID
+    uint64_t chainOffset;   // ChainSummary[chainCount]
+    uint64_t chainCount;
+    uint64_t namesOffset;   // ID strings, back to back
+    uint64_t namesSize;
+};
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+// Section [offset, offset + count * size) lies within a file of fileSize
+bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize) {
+    return offset <= fileSize && offset % 8 == 0 && count <= (fileSize - offset) / size;
+}
+
+} // namespace
+
+bool Archive::open(const std::string& path) {
+    close();
+    if (!file_.open(path) || file_.size() < sizeof(FileHeader)) {
+        close();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    uint64_t fileSize = file_.size();
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion || header.byteOrder != kByteOrder ||
+        header.entrySize != sizeof(ArchiveEntry) ||
+        !fits(header.indexOffset, header.entryCount, sizeof(ArchiveEntry), fileSize) ||
+        !fits(header.chainOffset, header.chainCount, sizeof(ChainSummary), fileSize) ||
+        !fits(header.namesOffset, header.namesSize, 1, fileSize)) {
+        close();
+        return false;
+    }
+    entries_ = reinterpret_cast<const ArchiveEntry*>(file_.data() + header.indexOffset);
+    chains_ = reinterpret_cast<const ChainSummary*>(file_.data() + header.chainOffset);
+    names_ = file_.data() + header.namesOffset;
+    count_ = header.entryCount;
+
+    // Bounds of every entry, so accessors need no checks
+    for (size_t i = 0; i < count_; ++i) {
+        const ArchiveEntry& e = entries_[i];
+        if (uint64_t(e.nameOffset) + e.nameLength > header.namesSize ||
+            uint64_t(e.chainFirst) + e.chainCount > header.chainCount ||
+            !fits(e.offset, e.size, 1, fileSize) ||
+            (i > 0 && !(id(i - 1) < id(i)))) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Archive::close() {
+    file_.close();
+    entries_ = nullptr;
+    chains_ = nullptr;
+    names_ = nullptr;
+    count_ = 0;
+}
+
+size_t Archive::find(std::string_view id) const {
+    size_t low = 0, high = count_;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (this->id(middle) < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < count_ && this->id(low) == id ? low : npos;
+}
+
+std::string_view Archive::id(size_t index) const {
+    const ArchiveEntry& e = entries_[index];
+    return std::string_view(names_ + e.nameOffset, e.nameLength);
+}
+
+ListSlice<ChainSummary> Archive::chains(size_t index) const {
+    const ArchiveEntry& e = entries_[index];
+    return ListSlice<ChainSummary>{chains_ + e.chainFirst, chains_ + e.chainFirst + e.chainCount};
+}
+
+std::string_view Archive::image(size_t index) const {
+    const ArchiveEntry& e = entries_[index];
+    return std::string_view(file_.data() + e.offset, e.size);
+}
+
+std::unique_ptr<Model> Archive::read(size_t index) const {
+    if (index >= count_) {
+        return nullptr;
+    }
+    return decodeModel(image(index));
+}
+
+std::unique_ptr<Model> Archive::read(std::string_view id) const {
+    size_t index = find(id);
+    return index == npos ? nullptr : read(index);
+}
+
+ArchiveWriter::ArchiveWriter(const std::string& path)
+    : path_(path), tempPath_(temporaryPathFor(path)),
+      out_(tempPath_, std::ios::binary | std::ios::trunc) {
+    // Reserve the header; finish() fills it in
+    FileHeader header{};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset_ = padded(sizeof(header));
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (!finished_) {
+        out_.close();
+        std::error_code ec;
+        fs::remove(tempPath_, ec);
+    }
+}
+
+bool ArchiveWriter::prepare(std::string_view id, const Model& model, ArchiveItem& item) {
+    item.id = std::string(id);
+    item.chains.clear();
+    // The ID stands in for the source path of the image
+    CacheKey key;
+    key.sourcePath = item.id;
+    if (!encodeModel(model, key, item.image)) {
+        return false;
+    }
+    item.entry = ArchiveEntry{};
+    item.entry.atomCount = uint32_t(model.atoms.size());
+    item.entry.hetAtomCount = uint32_t(model.hetAtoms.size());
+    item.entry.residueCount = uint32_t(model.residues.size());
+    for (const ChainRange& range : model.chainRanges) {
+        item.chains.push_back(ChainSummary{range.chainID,
+                                           range.atomEnd - range.atomBegin,
+                                           range.hetAtomEnd - range.hetAtomBegin,
+                                           range.residueEnd - range.residueBegin});
+    }
+    return true;
+}
+
+bool ArchiveWriter::add(const ArchiveItem& item) {
+    if (finished_ || !is_open() || !ids_.insert(item.id).second) {
+        return false;
+    }
+    static const char zeros[8] = {};
+    out_.write(item.image.data(), item.image.size());
+    out_.write(zeros, padded(item.image.size()) - item.image.size());
+
+    ArchiveEntry entry = item.entry;
+    entry.offset = offset_;
+    entry.size = item.image.size();
+    entry.nameOffset = uint32_t(names_.size());
+    entry.nameLength = uint32_t(item.id.size());
+    entry.chainFirst = uint32_t(chains_.size());
+    entry.chainCount = uint32_t(item.chains.size());
+    entries_.push_back(entry);
+    chains_.insert(chains_.end(), item.chains.begin(), item.chains.end());
+    names_ += item.id;
+    offset_ += padded(item.image.size());
+    return is_open();
+}
+
+bool ArchiveWriter::add(std::string_view id, const Model& model) {
+    ArchiveItem item;
+    return prepare(id, model, item) && add(item);
+}
+
+bool ArchiveWriter::finish() {
+    if (finished_ || !is_open()) {
+        return false;
+    }
+
+    // Index in ID order; chain summaries and names stay in insertion order
+    auto idOf = [this](const ArchiveEntry& e) {
+        return std::string_view(names_.data() + e.nameOffset, e.nameLength);
+    };
+    std::sort(entries_.begin(), entries_.end(),
+              [&](const ArchiveEntry& a, const ArchiveEntry& b) { return idOf(a) < idOf(b); });
+
+    static const char zeros[8] = {};
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.entrySize = sizeof(ArchiveEntry);
+    header.entryCount = entries_.size();
+    header.indexOffset = offset_;
+    header.chainOffset = header.indexOffset + entries_.size() * sizeof(ArchiveEntry);
+    header.chainCount = chains_.size();
+    header.namesOffset = header.chainOffset + chains_.size() * sizeof(ChainSummary);
+    header.namesSize = names_.size();
+    out_.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(ArchiveEntry));
+    out_.write(reinterpret_cast<const char*>(chains_.data()), chains_.size() * sizeof(ChainSummary));
+    out_.write(names_.data(), names_.size());
+    out_.write(zeros, padded(names_.size()) - names_.size());
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath_, path_, ec);
+    if (ec) {
+        return false;
+    }
+    finished_ = true;
+    return true;
+}
+
+} // namespace pdb
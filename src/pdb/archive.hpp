@@ -0,0 +1,123 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+#include "utils/mapped_file.hpp"
+#include <fstream>
+#include <unordered_set>
+
+namespace pdb {
+
+// Per-chain-ID counts stored in the archive index
+struct ChainSummary {
+    Code chainID;
+    uint32_t atomCount;
+    uint32_t hetAtomCount;
+    uint32_t residueCount;
+};
+
+// Index record of one archived structure, read in place from the file
+struct ArchiveEntry {
+    uint64_t offset;        // Model image (.fgl layout) from the file start
+    uint64_t size;
+    uint32_t nameOffset;    // ID, in the names pool
+    uint32_t nameLength;
+    uint32_t atomCount;
+    uint32_t hetAtomCount;
+    uint32_t residueCount;
+    uint32_t chainFirst;    // First ChainSummary
+    uint32_t chainCount;
+    uint32_t reserved;
+};
+
+// Packed multi-structure archive (.fgla). Model images in the cache
+// layout are stored back to back, followed by an index of ArchiveEntry
+// records sorted by ID, the chain summaries and the ID strings. Opening
+// maps the file and checks the index bounds; find() is a binary search
+// over the mapped index and read() decodes a single image, so no other
+// entry is touched. Like .fgl files, archives are tied to the build that
+// wrote them.
+class Archive {
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    // Constructors
+    Archive() = default;
+    explicit Archive(const std::string& path) { open(path); }
+
+    // Maps the archive at path; returns false if it is missing or invalid
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return file_.is_open(); }
+
+    size_t size() const { return count_; }
+    // Position of id in [0, size()), or npos
+    size_t find(std::string_view id) const;
+
+    // Entries are in ascending ID order
+    std::string_view id(size_t index) const;
+    const ArchiveEntry& entry(size_t index) const { return entries_[index]; }
+    ListSlice<ChainSummary> chains(size_t index) const;
+    std::string_view image(size_t index) const;
+
+    // Decodes one structure; nullptr if its image is corrupt or id absent
+    std::unique_ptr<Model> read(size_t index) const;
+    std::unique_ptr<Model> read(std::string_view id) const;
+
+private:
+    MappedFile file_;
+    const ArchiveEntry* entries_{nullptr};
+    const ChainSummary* chains_{nullptr};
+    const char* names_{nullptr};
+    size_t count_{0};
+};
+
+// One structure ready to be appended; prepare() may run on any thread
+struct ArchiveItem {
+    std::string id;
+    std::string image;
+    ArchiveEntry entry{};
+    std::vector<ChainSummary> chains;
+};
+
+// Writes an archive: images are streamed to a temporary file as they are
+// added, and finish() appends the sorted index and renames the file into
+// place. Not thread-safe; prepare items in parallel and add them in turn.
+class ArchiveWriter {
+public:
+    // Constructors
+    explicit ArchiveWriter(const std::string& path);
+    ~ArchiveWriter();
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    bool is_open() const { return out_.is_open() && out_.good(); }
+
+    // Encodes model with its chain summary; returns false if it cannot be
+    // encoded
+    static bool prepare(std::string_view id, const Model& model, ArchiveItem& item);
+
+    // Returns false on a duplicate ID or a write error
+    bool add(const ArchiveItem& item);
+    bool add(std::string_view id, const Model& model);
+
+    size_t size() const { return entries_.size(); }
+
+    // Writes the index and moves the archive into place; an unfinished
+    // writer removes its temporary file
+    bool finish();
+
+private:
+    std::string path_;
+    std::string tempPath_;
+    std::ofstream out_;
+    uint64_t offset_{0};
+    std::vector<ArchiveEntry> entries_;
+    std::vector<ChainSummary> chains_;
+    std::string names_;
+    std::unordered_set<std::string> ids_;
+    bool finished_{false};
+};
+
+} // namespace pdb
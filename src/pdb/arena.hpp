@@ -0,0 +1,137 @@
+#pragma once
+
+#include "common.hpp"
+#include "atom.hpp"
+#include "residue.hpp"
+#include "chain.hpp"
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace pdb {
+
+// Monotonic pool: objects are placed in geometrically growing blocks and
+// only destroyed, all together, with the pool. Addresses never move, so
+// pools can be spliced without touching the objects.
+template <typename T>
+class ArenaPool {
+public:
+    ArenaPool() = default;
+    ArenaPool(ArenaPool&& other) noexcept
+        : blocks_(std::move(other.blocks_)), count_(std::exchange(other.count_, 0)) {
+        other.blocks_.clear();
+    }
+    ArenaPool& operator=(ArenaPool&& other) noexcept {
+        if (this != &other) {
+            clear();
+            blocks_ = std::move(other.blocks_);
+            count_ = std::exchange(other.count_, 0);
+            other.blocks_.clear();
+        }
+        return *this;
+    }
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+    ~ArenaPool() { clear(); }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (blocks_.empty() || blocks_.back().size == blocks_.back().capacity) {
+            grow(0);
+        }
+        Block& block = blocks_.back();
+        T* object = new (block.data + block.size) T(std::forward<Args>(args)...);
+        ++block.size;
+        ++count_;
+        return object;
+    }
+
+    // Makes room for count more objects in a single block
+    void reserve(size_t count) {
+        if (count > 0 && (blocks_.empty() || blocks_.back().capacity - blocks_.back().size < count)) {
+            grow(count);
+        }
+    }
+
+    // Takes over other's objects; pointers to them stay valid
+    void append(ArenaPool&& other) {
+        blocks_.insert(blocks_.end(), other.blocks_.begin(), other.blocks_.end());
+        count_ += std::exchange(other.count_, 0);
+        other.blocks_.clear();
+    }
+
+    size_t size() const { return count_; }
+
+    void clear() {
+        for (Block& block : blocks_) {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for (size_t i = 0; i < block.size; ++i) {
+                    block.data[i].~T();
+                }
+            }
+            ::operator delete(block.data);
+        }
+        blocks_.clear();
+        count_ = 0;
+    }
+
+private:
+    static constexpr size_t kFirstBlock = 64;
+    static constexpr size_t kMaxBlock = 16384;
+
+    struct Block {
+        T* data;
+        size_t size;
+        size_t capacity;
+    };
+
+    void grow(size_t minimum) {
+        size_t capacity = blocks_.empty() ? kFirstBlock
+                                          : std::min(blocks_.back().capacity * 2, kMaxBlock);
+        capacity = std::max(capacity, minimum);
+        blocks_.reserve(blocks_.size() + 1);
+        T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        blocks_.push_back(Block{data, 0, capacity});
+    }
+
+    std::vector<Block> blocks_;
+    size_t count_{0};
+};
+
+// Storage for the atoms, residues and chains of a Model. The readers
+// allocate from it so a model is built and freed in a few bulk operations
+// instead of one heap block per object. make() returns a plain pointer: the
+// object lives until the arena is destroyed and nothing else owns it.
+class ModelArena {
+public:
+    ArenaPool<Atom> atoms;
+    ArenaPool<Residue> residues;
+    ArenaPool<Chain> chains;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        return pool<T>().create(std::forward<Args>(args)...);
+    }
+
+    void append(ModelArena&& other) {
+        atoms.append(std::move(other.atoms));
+        residues.append(std::move(other.residues));
+        chains.append(std::move(other.chains));
+    }
+
+private:
+    template <typename T>
+    ArenaPool<T>& pool() {
+        if constexpr (std::is_same_v<T, Atom>) {
+            return atoms;
+        } else if constexpr (std::is_same_v<T, Residue>) {
+            return residues;
+        } else {
+            static_assert(std::is_same_v<T, Chain>, "ModelArena holds atoms, residues and chains");
+            return chains;
+        }
+    }
+};
+
+} // namespace pdb
@@ -2,40 +2,38 @@
 
 namespace pdb {
 
-std::unique_ptr<Atom> Atom::parseAtom(const std::string& line) {
+bool Atom::parseAtom(std::string_view line, Atom& atom) {
     if (line.length() < 80) {
-        return nullptr; // Insufficient data
+        return false; // Insufficient data
     }
     
-    auto atom = std::make_unique<Atom>();
-    
     // Parse according to PDB format specification
-    atom->serial = parseInt(line.substr(6, 5));
-    atom->name = parseString(line.substr(12, 4));
-    atom->altLoc = parseString(line.substr(16, 1));
-    atom->resName = parseString(line.substr(17, 3));
-    atom->chainID = parseString(line.substr(21, 1));
-    atom->resSeq = parseInt(line.substr(22, 4));
-    atom->iCode = parseString(line.substr(26, 1));
+    atom.serial = parseHybrid36(line.substr(6, 5), 5);
+    atom.name = parseCode(line.substr(12, 4));
+    atom.altLoc = parseCode(line.substr(16, 1));
+    atom.resName = parseCode(line.substr(17, 3));
+    atom.chainID = parseCode(line.substr(21, 1));
+    atom.resSeq = parseHybrid36(line.substr(22, 4), 4);
+    atom.iCode = parseCode(line.substr(26, 1));
     
     // Coordinates
-    atom->x = parseFloat(line.substr(30, 8));
-    atom->y = parseFloat(line.substr(38, 8));
-    atom->z = parseFloat(line.substr(46, 8));
+    atom.x = parseFloat(line.substr(30, 8));
+    atom.y = parseFloat(line.substr(38, 8));
+    atom.z = parseFloat(line.substr(46, 8));
     
     // Occupancy and temperature factor
-    atom->occupancy = parseFloat(line.substr(54, 6));
-    atom->tempFactor = parseFloat(line.substr(60, 6));
+    atom.occupancy = parseFloat(line.substr(54, 6));
+    atom.tempFactor = parseFloat(line.substr(60, 6));
     
     // Element and charge (check bounds)
     if (line.length() >= 78) {
-        atom->element = parseString(line.substr(76, 2));
+        atom.element = parseCode(line.substr(76, 2));
     }
     if (line.length() >= 80) {
-        atom->charge = parseString(line.substr(78, 2));
+        atom.charge = parseCode(line.substr(78, 2));
     }
     
-    return atom;
+    return true;
 }
 
 } // namespace pdb
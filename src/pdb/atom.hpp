@@ -9,22 +9,23 @@ public:
     // Constructor
     Atom() = default;
     
-    // PDB record parsing
-    static std::unique_ptr<Atom> parseAtom(const std::string& line);
+    // PDB record parsing into atom; false (atom untouched) if the line is
+    // too short
+    static bool parseAtom(std::string_view line, Atom& atom);
     
     // Data members (matching PDB format)
     int serial{0};
-    std::string name;
-    std::string altLoc;
-    std::string resName;
-    std::string chainID;
+    Code name;
+    Code altLoc;
+    Code resName;
+    Code chainID;
     int resSeq{0};
-    std::string iCode;
+    Code iCode;
     double x{0.0}, y{0.0}, z{0.0};
     double occupancy{0.0};
     double tempFactor{0.0};
-    std::string element;
-    std::string charge;
+    Code element;
+    Code charge;
 };
 
 } // namespace pdb
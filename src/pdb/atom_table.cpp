@@ -0,0 +1,79 @@
+#include "pdb/atom_table.hpp"
+#include "pdb/model.hpp"
+
+namespace pdb {
+
+namespace {
+
+char firstChar(Code code) {
+    return code.empty() ? ' ' : code[0];
+}
+
+} // namespace
+
+AtomTable::AtomTable(const Model& model) {
+    reserve(model.atoms.size() + model.hetAtoms.size());
+    residueBegin.reserve(model.residues.size() + 1);
+    residueType.reserve(model.residues.size());
+    chainBegin.reserve(model.chains.size() + 1);
+
+    // Walk the hierarchy so residues and chains become contiguous row ranges
+    chainBegin.push_back(0);
+    residueBegin.push_back(0);
+    for (const auto& chain : model.chains) {
+        for (const auto& residue : chain->residues) {
+            uint32_t residueIdx = static_cast<uint32_t>(residueType.size());
+            for (const auto& atom : residue->atoms) {
+                append(*atom, false);
+                residueIndex.back() = residueIdx;
+            }
+            residueType.push_back(residue->type);
+            residueBegin.push_back(static_cast<uint32_t>(size()));
+        }
+        chainBegin.push_back(static_cast<uint32_t>(residueType.size()));
+    }
+
+    for (const auto& atom : model.hetAtoms) {
+        append(*atom, true);
+    }
+}
+
+void AtomTable::reserve(size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    z.reserve(count);
+    occupancy.reserve(count);
+    tempFactor.reserve(count);
+    serial.reserve(count);
+    resSeq.reserve(count);
+    name.reserve(count);
+    resName.reserve(count);
+    element.reserve(count);
+    charge.reserve(count);
+    chainID.reserve(count);
+    altLoc.reserve(count);
+    iCode.reserve(count);
+    hetero.reserve(count);
+    residueIndex.reserve(count);
+}
+
+void AtomTable::append(const Atom& atom, bool het) {
+    x.push_back(static_cast<float>(atom.x));
+    y.push_back(static_cast<float>(atom.y));
+    z.push_back(static_cast<float>(atom.z));
+    occupancy.push_back(static_cast<float>(atom.occupancy));
+    tempFactor.push_back(static_cast<float>(atom.tempFactor));
+    serial.push_back(atom.serial);
+    resSeq.push_back(atom.resSeq);
+    name.push_back(atom.name);
+    resName.push_back(atom.resName);
+    element.push_back(atom.element);
+    charge.push_back(atom.charge);
+    chainID.push_back(atom.chainID);
+    altLoc.push_back(firstChar(atom.altLoc));
+    iCode.push_back(firstChar(atom.iCode));
+    hetero.push_back(het ? 1 : 0);
+    residueIndex.push_back(kNoResidue);
+}
+
+} // namespace pdb
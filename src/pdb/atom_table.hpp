@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.hpp"
+#include "atom.hpp"
+#include <cstdint>
+
+namespace pdb {
+
+class AtomTable;
+
+// Lightweight, non-owning view of one row of an AtomTable
+class AtomView {
+public:
+    AtomView(const AtomTable& table, size_t index) : table_(&table), index_(index) {}
+
+    size_t index() const { return index_; }
+    int serial() const;
+    Code name() const;
+    char altLoc() const;
+    Code resName() const;
+    Code chainID() const;
+    int resSeq() const;
+    char iCode() const;
+    float x() const;
+    float y() const;
+    float z() const;
+    float occupancy() const;
+    float tempFactor() const;
+    Code element() const;
+    Code charge() const;
+    bool hetero() const;
+
+private:
+    const AtomTable* table_;
+    size_t index_;
+};
+
+// Contiguous range of table rows belonging to one residue
+class ResidueView {
+public:
+    ResidueView(const AtomTable& table, size_t index) : table_(&table), index_(index) {}
+
+    size_t index() const { return index_; }
+    size_t atomBegin() const;
+    size_t atomEnd() const;
+    size_t size() const { return atomEnd() - atomBegin(); }
+    AtomView atom(size_t i) const;
+    Code resName() const;
+    Code chainID() const;
+    int resSeq() const;
+    ResidueType type() const;
+
+private:
+    const AtomTable* table_;
+    size_t index_;
+};
+
+// Contiguous range of residues belonging to one chain
+class ChainView {
+public:
+    ChainView(const AtomTable& table, size_t index) : table_(&table), index_(index) {}
+
+    size_t index() const { return index_; }
+    size_t residueBegin() const;
+    size_t residueEnd() const;
+    size_t size() const { return residueEnd() - residueBegin(); }
+    ResidueView residue(size_t i) const;
+    Code chainID() const;
+
+private:
+    const AtomTable* table_;
+    size_t index_;
+};
+
+// Structure-of-arrays storage for the atoms of a Model. Rows are in Model
+// order: all ATOM records, then all HETATM records. Residues and chains are
+// index ranges over the rows, so passes over coordinates or identifiers
+// touch only the columns they need.
+class AtomTable {
+public:
+    static constexpr uint32_t kNoResidue = 0xffffffffu;
+
+    // Constructors
+    AtomTable() = default;
+    explicit AtomTable(const Model& model);
+
+    // Rows
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void reserve(size_t count);
+    void append(const Atom& atom, bool het);
+    AtomView atom(size_t i) const { return AtomView(*this, i); }
+
+    // Residue and chain ranges (ATOM records only, as in Model::residues)
+    size_t residueCount() const { return residueType.size(); }
+    size_t chainCount() const { return chainBegin.empty() ? 0 : chainBegin.size() - 1; }
+    ResidueView residue(size_t i) const { return ResidueView(*this, i); }
+    ChainView chain(size_t i) const { return ChainView(*this, i); }
+
+    // Atom columns
+    std::vector<float> x, y, z;
+    std::vector<float> occupancy;
+    std::vector<float> tempFactor;
+    std::vector<int32_t> serial;
+    std::vector<int32_t> resSeq;
+    std::vector<Code> name;
+    std::vector<Code> resName;
+    std::vector<Code> element;
+    std::vector<Code> charge;
+    std::vector<Code> chainID;
+    std::vector<char> altLoc;
+    std::vector<char> iCode;
+    std::vector<uint8_t> hetero;
+    std::vector<uint32_t> residueIndex;
+
+    // Residue columns; residueBegin holds residueCount() + 1 row offsets
+    std::vector<uint32_t> residueBegin;
+    std::vector<ResidueType> residueType;
+
+    // Chain columns; chainBegin holds chainCount() + 1 residue offsets
+    std::vector<uint32_t> chainBegin;
+};
+
+// AtomView accessors
+inline int AtomView::serial() const { return table_->serial[index_]; }
+inline Code AtomView::name() const { return table_->name[index_]; }
+inline char AtomView::altLoc() const { return table_->altLoc[index_]; }
+inline Code AtomView::resName() const { return table_->resName[index_]; }
+inline Code AtomView::chainID() const { return table_->chainID[index_]; }
+inline int AtomView::resSeq() const { return table_->resSeq[index_]; }
+inline char AtomView::iCode() const { return table_->iCode[index_]; }
+inline float AtomView::x() const { return table_->x[index_]; }
+inline float AtomView::y() const { return table_->y[index_]; }
+inline float AtomView::z() const { return table_->z[index_]; }
+inline float AtomView::occupancy() const { return table_->occupancy[index_]; }
+inline float AtomView::tempFactor() const { return table_->tempFactor[index_]; }
+inline Code AtomView::element() const { return table_->element[index_]; }
+inline Code AtomView::charge() const { return table_->charge[index_]; }
+inline bool AtomView::hetero() const { return table_->hetero[index_] != 0; }
+
+// ResidueView accessors
+inline size_t ResidueView::atomBegin() const { return table_->residueBegin[index_]; }
+inline size_t ResidueView::atomEnd() const { return table_->residueBegin[index_ + 1]; }
+inline AtomView ResidueView::atom(size_t i) const { return AtomView(*table_, atomBegin() + i); }
+inline Code ResidueView::resName() const { return table_->resName[atomBegin()]; }
+inline Code ResidueView::chainID() const { return table_->chainID[atomBegin()]; }
+inline int ResidueView::resSeq() const { return table_->resSeq[atomBegin()]; }
+inline ResidueType ResidueView::type() const { return table_->residueType[index_]; }
+
+// ChainView accessors
+inline size_t ChainView::residueBegin() const { return table_->chainBegin[index_]; }
+inline size_t ChainView::residueEnd() const { return table_->chainBegin[index_ + 1]; }
+inline ResidueView ChainView::residue(size_t i) const { return ResidueView(*table_, residueBegin() + i); }
+inline Code ChainView::chainID() const { return table_->chainID[table_->residueBegin[residueBegin()]]; }
+
+} // namespace pdb
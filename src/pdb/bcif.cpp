@@ -0,0 +1,754 @@
+#include "pdb/bcif.hpp"
+#include "pdb/atom.hpp"
+#include "pdb/cif.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace pdb {
+
+namespace {
+
+// _atom_site categories with fewer rows are decoded on one thread
+constexpr size_t kMinChunkRows = size_t(1) << 18;
+
+// Nesting limit for MessagePack containers
+constexpr int kMaxDepth = 64;
+
+// Decoded MessagePack value; strings and binary blobs point into the buffer
+struct MsgValue {
+    enum class Type { Nil, Bool, Int, Float, String, Binary, Array, Map };
+
+    Type type{Type::Nil};
+    int64_t integer{0};
+    double real{0.0};
+    std::string_view bytes;
+    std::vector<MsgValue> items;  // Array elements, or map keys and values interleaved
+
+    const MsgValue* find(std::string_view key) const {
+        if (type != Type::Map) {
+            return nullptr;
+        }
+        for (size_t i = 0; i + 1 < items.size(); i += 2) {
+            if (items[i].type == Type::String && items[i].bytes == key) {
+                return &items[i + 1];
+            }
+        }
+        return nullptr;
+    }
+
+    int64_t asInt() const {
+        return type == Type::Float ? static_cast<int64_t>(real) : integer;
+    }
+    double asFloat() const {
+        return type == Type::Float ? real : static_cast<double>(integer);
+    }
+};
+
+// Reads one MessagePack value; returns false on truncated or unsupported input
+class MsgReader {
+public:
+    explicit MsgReader(std::string_view data) : data_(data) {}
+
+    bool read(MsgValue& out, int depth = 0) {
+        uint8_t tag = 0;
+        if (depth > kMaxDepth || !readBigEndian(tag)) {
+            return false;
+        }
+        if (tag <= 0x7f || tag >= 0xe0) {
+            return setInt(out, static_cast<int8_t>(tag)); // Positive and negative fixint
+        }
+        if ((tag & 0xf0) == 0x80) {
+            return readItems(out, MsgValue::Type::Map, tag & 0x0f, depth);
+        }
+        if ((tag & 0xf0) == 0x90) {
+            return readItems(out, MsgValue::Type::Array, tag & 0x0f, depth);
+        }
+        if ((tag & 0xe0) == 0xa0) {
+            return readBytes(out, MsgValue::Type::String, tag & 0x1f);
+        }
+
+        switch (tag) {
+        case 0xc0: out.type = MsgValue::Type::Nil; return true;
+        case 0xc2: out.type = MsgValue::Type::Bool; out.integer = 0; return true;
+        case 0xc3: out.type = MsgValue::Type::Bool; out.integer = 1; return true;
+        case 0xc4: return readSized<uint8_t>(out, MsgValue::Type::Binary);
+        case 0xc5: return readSized<uint16_t>(out, MsgValue::Type::Binary);
+        case 0xc6: return readSized<uint32_t>(out, MsgValue::Type::Binary);
+        case 0xc7: return readSized<uint8_t>(out, MsgValue::Type::Binary, 1);
+        case 0xc8: return readSized<uint16_t>(out, MsgValue::Type::Binary, 1);
+        case 0xc9: return readSized<uint32_t>(out, MsgValue::Type::Binary, 1);
+        case 0xca: {
+            uint32_t bits = 0;
+            float value = 0.0f;
+            if (!readBigEndian(bits)) {
+                return false;
+            }
+            std::memcpy(&value, &bits, sizeof(value));
+            out.type = MsgValue::Type::Float;
+            out.real = value;
+            return true;
+        }
+        case 0xcb: {
+            uint64_t bits = 0;
+            if (!readBigEndian(bits)) {
+                return false;
+            }
+            std::memcpy(&out.real, &bits, sizeof(out.real));
+            out.type = MsgValue::Type::Float;
+            return true;
+        }
+        case 0xcc: return readInt<uint8_t>(out);
+        case 0xcd: return readInt<uint16_t>(out);
+        case 0xce: return readInt<uint32_t>(out);
+        case 0xcf: return readInt<uint64_t>(out);
+        case 0xd0: return readInt<int8_t>(out);
+        case 0xd1: return readInt<int16_t>(out);
+        case 0xd2: return readInt<int32_t>(out);
+        case 0xd3: return readInt<int64_t>(out);
+        case 0xd4: return readBytes(out, MsgValue::Type::Binary, 1, 1);
+        case 0xd5: return readBytes(out, MsgValue::Type::Binary, 2, 1);
+        case 0xd6: return readBytes(out, MsgValue::Type::Binary, 4, 1);
+        case 0xd7: return readBytes(out, MsgValue::Type::Binary, 8, 1);
+        case 0xd8: return readBytes(out, MsgValue::Type::Binary, 16, 1);
+        case 0xd9: return readSized<uint8_t>(out, MsgValue::Type::String);
+        case 0xda: return readSized<uint16_t>(out, MsgValue::Type::String);
+        case 0xdb: return readSized<uint32_t>(out, MsgValue::Type::String);
+        case 0xdc: return readCount<uint16_t>(out, MsgValue::Type::Array, depth);
+        case 0xdd: return readCount<uint32_t>(out, MsgValue::Type::Array, depth);
+        case 0xde: return readCount<uint16_t>(out, MsgValue::Type::Map, depth);
+        case 0xdf: return readCount<uint32_t>(out, MsgValue::Type::Map, depth);
+        default: return false;
+        }
+    }
+
+private:
+    template <typename T>
+    bool readBigEndian(T& out) {
+        if (data_.size() - pos_ < sizeof(T)) {
+            return false;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value = (value << 8) | static_cast<uint8_t>(data_[pos_ + i]);
+        }
+        pos_ += sizeof(T);
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    bool setInt(MsgValue& out, int64_t value) {
+        out.type = MsgValue::Type::Int;
+        out.integer = value;
+        return true;
+    }
+
+    template <typename T>
+    bool readInt(MsgValue& out) {
+        T value{};
+        return readBigEndian(value) && setInt(out, static_cast<int64_t>(value));
+    }
+
+    // skip: leading ext type byte
+    bool readBytes(MsgValue& out, MsgValue::Type type, size_t size, size_t skip = 0) {
+        if (data_.size() - pos_ < skip + size) {
+            return false;
+        }
+        out.type = type;
+        out.bytes = data_.substr(pos_ + skip, size);
+        pos_ += skip + size;
+        return true;
+    }
+
+    template <typename T>
+    bool readSized(MsgValue& out, MsgValue::Type type, size_t skip = 0) {
+        T size{};
+        return readBigEndian(size) && readBytes(out, type, size, skip);
+    }
+
+    bool readItems(MsgValue& out, MsgValue::Type type, size_t count, int depth) {
+        if (type == MsgValue::Type::Map) {
+            count *= 2;
+        }
+        // Every item takes at least one byte
+        if (count > data_.size() - pos_) {
+            return false;
+        }
+        out.type = type;
+        out.items.resize(count);
+        for (auto& item : out.items) {
+            if (!read(item, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool readCount(MsgValue& out, MsgValue::Type type, int depth) {
+        T count{};
+        return readBigEndian(count) && readItems(out, type, count, depth);
+    }
+
+    std::string_view data_;
+    size_t pos_{0};
+};
+
+// Column data between codec steps
+struct Array {
+    enum class Kind { Bytes, Int, Float, String };
+
+    Kind kind{Kind::Bytes};
+    std::string_view bytes;
+    std::vector<int32_t> ints;
+    std::vector<double> floats;
+    std::vector<std::string_view> strings;
+
+    size_t size() const {
+        switch (kind) {
+        case Kind::Int: return ints.size();
+        case Kind::Float: return floats.size();
+        case Kind::String: return strings.size();
+        default: return bytes.size();
+        }
+    }
+};
+
+// Little-endian element of a ByteArray
+template <typename T>
+T loadLittleEndian(const char* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= uint64_t(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    T out;
+    if constexpr (sizeof(T) == 8) {
+        std::memcpy(&out, &value, sizeof(out));
+    } else {
+        uint32_t narrow = static_cast<uint32_t>(value);
+        std::memcpy(&out, &narrow, sizeof(out));
+    }
+    return out;
+}
+
+template <typename T, typename U>
+void widen(std::string_view bytes, std::vector<U>& out) {
+    size_t count = bytes.size() / sizeof(T);
+    out.resize(count);
+    const char* data = bytes.data();
+    for (size_t i = 0; i < count; ++i) {
+        if constexpr (sizeof(T) == 1) {
+            out[i] = static_cast<U>(static_cast<T>(data[i]));
+        } else if constexpr (sizeof(T) == 2) {
+            uint16_t bits = static_cast<uint16_t>(static_cast<uint8_t>(data[2 * i]) |
+                                                  (static_cast<uint8_t>(data[2 * i + 1]) << 8));
+            out[i] = static_cast<U>(static_cast<T>(bits));
+        } else {
+            out[i] = static_cast<U>(loadLittleEndian<T>(data + sizeof(T) * i));
+        }
+    }
+}
+
+bool decodeByteArray(int type, Array& array) {
+    enum { Int8 = 1, Int16 = 2, Int32 = 3, Uint8 = 4, Uint16 = 5, Uint32 = 6,
+           Float32 = 32, Float64 = 33 };
+    static const size_t kSizes[] = {0, 1, 2, 4, 1, 2, 4};
+    size_t size = (type >= Int8 && type <= Uint32) ? kSizes[type]
+                : type == Float32 ? 4 : type == Float64 ? 8 : 0;
+    if (size == 0 || array.bytes.size() % size != 0) {
+        return false;
+    }
+
+    switch (type) {
+    case Int8: widen<int8_t>(array.bytes, array.ints); break;
+    case Int16: widen<int16_t>(array.bytes, array.ints); break;
+    case Int32: widen<int32_t>(array.bytes, array.ints); break;
+    case Uint8: widen<uint8_t>(array.bytes, array.ints); break;
+    case Uint16: widen<uint16_t>(array.bytes, array.ints); break;
+    case Uint32: widen<uint32_t>(array.bytes, array.ints); break;
+    case Float32: widen<float>(array.bytes, array.floats); break;
+    case Float64: widen<double>(array.bytes, array.floats); break;
+    }
+    array.kind = type >= Float32 ? Array::Kind::Float : Array::Kind::Int;
+    return true;
+}
+
+// In-place prefix sum starting from origin; wraps like the encoder's int32s
+void deltaDecode(std::vector<int32_t>& values, int32_t origin) {
+    int32_t* data = values.data();
+    const size_t n = values.size();
+    size_t i = 0;
+    uint32_t carry = static_cast<uint32_t>(origin);
+#if defined(__SSE2__)
+    // Four lanes at a time: two shifted adds give the in-register prefix
+    // sum, then the running total is broadcast from the last lane
+    __m128i total = _mm_set1_epi32(origin);
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, total);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), x);
+        total = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    carry = static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+#endif
+    for (; i < n; ++i) {
+        carry += static_cast<uint32_t>(data[i]);
+        data[i] = static_cast<int32_t>(carry);
+    }
+}
+
+// In-place IntegerPacking decode: a value at either limit continues into the
+// next element, so large values are sums of several packed ones
+void unpackIntegers(std::vector<int32_t>& values, int byteCount, bool isUnsigned) {
+    const int32_t upper = isUnsigned ? (byteCount == 1 ? 0xff : 0xffff)
+                                     : (byteCount == 1 ? 0x7f : 0x7fff);
+    const int32_t lower = isUnsigned ? upper : (byteCount == 1 ? -0x80 : -0x8000);
+    int32_t* data = values.data();
+    const size_t n = values.size();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < n) {
+#if defined(__SSE2__)
+        // Most values fit in one element: copy blocks without limit values
+        const __m128i upperLanes = _mm_set1_epi32(upper);
+        const __m128i lowerLanes = _mm_set1_epi32(lower);
+        while (i + 4 <= n) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i limit = _mm_or_si128(_mm_cmpeq_epi32(x, upperLanes),
+                                         _mm_cmpeq_epi32(x, lowerLanes));
+            if (_mm_movemask_epi8(limit) != 0) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + j), x);
+            i += 4;
+            j += 4;
+        }
+        if (i >= n) {
+            break;
+        }
+#endif
+        uint32_t value = 0;
+        while (i < n && (data[i] == upper || data[i] == lower)) {
+            value += static_cast<uint32_t>(data[i++]);
+        }
+        if (i < n) {
+            value += static_cast<uint32_t>(data[i++]);
+        }
+        data[j++] = static_cast<int32_t>(value);
+    }
+    values.resize(j);
+}
+
+bool applyEncodings(const MsgValue& encodings, Array& array);
+
+bool applyEncoding(const MsgValue& encoding, Array& array) {
+    const MsgValue* kind = encoding.find("kind");
+    if (!kind || kind->type != MsgValue::Type::String) {
+        return false;
+    }
+    auto number = [&](std::string_view key) {
+        const MsgValue* value = encoding.find(key);
+        return value ? value->asFloat() : 0.0;
+    };
+
+    if (kind->bytes == "ByteArray") {
+        return array.kind == Array::Kind::Bytes &&
+               decodeByteArray(static_cast<int>(number("type")), array);
+    }
+    if (kind->bytes == "StringArray") {
+        const MsgValue* dataEncoding = encoding.find("dataEncoding");
+        const MsgValue* offsetEncoding = encoding.find("offsetEncoding");
+        const MsgValue* stringData = encoding.find("stringData");
+        const MsgValue* offsetBytes = encoding.find("offsets");
+        if (array.kind != Array::Kind::Bytes || !dataEncoding || !offsetEncoding ||
+            !stringData || !offsetBytes) {
+            return false;
+        }
+        Array offsets;
+        offsets.bytes = offsetBytes->bytes;
+        if (!applyEncodings(*dataEncoding, array) || array.kind != Array::Kind::Int ||
+            !applyEncodings(*offsetEncoding, offsets) || offsets.kind != Array::Kind::Int) {
+            return false;
+        }
+        // Each index selects [offsets[i], offsets[i + 1]); -1 is a null value
+        std::string_view text = stringData->bytes;
+        std::vector<std::string_view> strings(array.ints.size());
+        for (size_t i = 0; i < strings.size(); ++i) {
+            int32_t index = array.ints[i];
+            if (index < 0) {
+                continue;
+            }
+            if (size_t(index) + 1 >= offsets.ints.size()) {
+                return false;
+            }
+            int32_t begin = offsets.ints[index];
+            int32_t end = offsets.ints[index + 1];
+            if (begin < 0 || end < begin || size_t(end) > text.size()) {
+                return false;
+            }
+            strings[i] = text.substr(begin, end - begin);
+        }
+        array.strings = std::move(strings);
+        array.ints.clear();
+        array.kind = Array::Kind::String;
+        return true;
+    }
+
+    // The remaining codecs all take integers
+    if (array.kind != Array::Kind::Int) {
+        return false;
+    }
+    if (kind->bytes == "FixedPoint") {
+        double factor = number("factor");
+        if (factor == 0.0) {
+            return false;
+        }
+        array.floats.resize(array.ints.size());
+        for (size_t i = 0; i < array.ints.size(); ++i) {
+            array.floats[i] = array.ints[i] / factor;
+        }
+    } else if (kind->bytes == "IntervalQuantization") {
+        double min = number("min");
+        double steps = number("numSteps");
+        double delta = steps > 1 ? (number("max") - min) / (steps - 1) : 0.0;
+        array.floats.resize(array.ints.size());
+        for (size_t i = 0; i < array.ints.size(); ++i) {
+            array.floats[i] = min + delta * array.ints[i];
+        }
+    } else if (kind->bytes == "RunLength") {
+        // (value, count) pairs
+        size_t srcSize = static_cast<size_t>(std::max(0.0, number("srcSize")));
+        if (array.ints.size() % 2 != 0) {
+            return false;
+        }
+        size_t total = 0;
+        for (size_t i = 1; i < array.ints.size(); i += 2) {
+            if (array.ints[i] < 0 || (total += size_t(array.ints[i])) > srcSize) {
+                return false;
+            }
+        }
+        std::vector<int32_t> values;
+        values.reserve(total);
+        for (size_t i = 0; i < array.ints.size(); i += 2) {
+            values.insert(values.end(), array.ints[i + 1], array.ints[i]);
+        }
+        array.ints = std::move(values);
+        return true;
+    } else if (kind->bytes == "Delta") {
+        deltaDecode(array.ints, static_cast<int32_t>(number("origin")));
+        return true;
+    } else if (kind->bytes == "IntegerPacking") {
+        int byteCount = static_cast<int>(number("byteCount"));
+        const MsgValue* isUnsigned = encoding.find("isUnsigned");
+        if (byteCount != 1 && byteCount != 2) {
+            return false;
+        }
+        unpackIntegers(array.ints, byteCount, isUnsigned && isUnsigned->integer != 0);
+        return true;
+    } else {
+        return false;
+    }
+    array.ints.clear();
+    array.kind = Array::Kind::Float;
+    return true;
+}
+
+// Encodings are listed in the order they were applied, so undo them in reverse
+bool applyEncodings(const MsgValue& encodings, Array& array) {
+    if (encodings.type != MsgValue::Type::Array) {
+        return false;
+    }
+    for (auto it = encodings.items.rbegin(); it != encodings.items.rend(); ++it) {
+        if (!applyEncoding(*it, array)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes an encoded data object: {data: bytes, encoding: [...]}
+bool decodeData(const MsgValue& data, Array& array) {
+    const MsgValue* bytes = data.find("data");
+    const MsgValue* encoding = data.find("encoding");
+    if (!bytes || !encoding || bytes->type != MsgValue::Type::Binary) {
+        return false;
+    }
+    array = Array();
+    array.bytes = bytes->bytes;
+    return applyEncodings(*encoding, array);
+}
+
+// One decoded column; rows masked as '.' or '?' read as empty or zero
+struct Column {
+    std::string_view name;
+    Array values;
+    std::vector<int32_t> mask;  // Empty when every row is present
+
+    bool present(size_t row) const {
+        return mask.empty() || mask[row] == 0;
+    }
+    std::string_view text(size_t row) const {
+        return present(row) && values.kind == Array::Kind::String ? values.strings[row]
+                                                                  : std::string_view();
+    }
+    int integer(size_t row) const {
+        if (!present(row)) {
+            return 0;
+        }
+        switch (values.kind) {
+        case Array::Kind::Int: return values.ints[row];
+        case Array::Kind::Float: return static_cast<int>(values.floats[row]);
+        case Array::Kind::String: return CifModelBuilder::toInt(values.strings[row]);
+        default: return 0;
+        }
+    }
+    double real(size_t row) const {
+        if (!present(row)) {
+            return 0.0;
+        }
+        switch (values.kind) {
+        case Array::Kind::Int: return values.ints[row];
+        case Array::Kind::Float: return values.floats[row];
+        case Array::Kind::String: return CifModelBuilder::toFloat(values.strings[row]);
+        default: return 0.0;
+        }
+    }
+};
+
+// Decodes every column of a category; columns that fail to decode or have
+// the wrong length are left out
+size_t decodeCategory(const MsgValue& category, std::vector<Column>& columns) {
+    const MsgValue* rowCount = category.find("rowCount");
+    const MsgValue* list = category.find("columns");
+    if (!rowCount || !list || list->type != MsgValue::Type::Array || rowCount->asInt() < 0) {
+        return 0;
+    }
+    size_t rows = static_cast<size_t>(rowCount->asInt());
+
+    for (const auto& item : list->items) {
+        const MsgValue* name = item.find("name");
+        const MsgValue* data = item.find("data");
+        const MsgValue* mask = item.find("mask");
+        if (!name || !data) {
+            continue;
+        }
+        Column column;
+        column.name = name->bytes;
+        if (!decodeData(*data, column.values) || column.values.size() != rows) {
+            continue;
+        }
+        if (mask && mask->type != MsgValue::Type::Nil) {
+            Array maskValues;
+            if (!decodeData(*mask, maskValues) || maskValues.kind != Array::Kind::Int ||
+                maskValues.ints.size() != rows) {
+                continue;
+            }
+            column.mask = std::move(maskValues.ints);
+        }
+        columns.push_back(std::move(column));
+    }
+    return rows;
+}
+
+const Column* findColumn(const std::vector<Column>& columns, std::string_view name,
+                         std::string_view fallback = {}) {
+    for (const auto& column : columns) {
+        if (column.name == name) {
+            return &column;
+        }
+    }
+    return fallback.empty() ? nullptr : findColumn(columns, fallback);
+}
+
+// _atom_site columns read into Atom, preferring author identifiers as
+// CifReader does
+struct AtomSiteColumns {
+    explicit AtomSiteColumns(const std::vector<Column>& columns)
+        : group(findColumn(columns, "group_PDB")),
+          serial(findColumn(columns, "id")),
+          name(findColumn(columns, "auth_atom_id", "label_atom_id")),
+          altLoc(findColumn(columns, "label_alt_id")),
+          resName(findColumn(columns, "auth_comp_id", "label_comp_id")),
+          chainID(findColumn(columns, "auth_asym_id", "label_asym_id")),
+          resSeq(findColumn(columns, "auth_seq_id", "label_seq_id")),
+          iCode(findColumn(columns, "pdbx_PDB_ins_code")),
+          x(findColumn(columns, "Cartn_x")),
+          y(findColumn(columns, "Cartn_y")),
+          z(findColumn(columns, "Cartn_z")),
+          occupancy(findColumn(columns, "occupancy")),
+          tempFactor(findColumn(columns, "B_iso_or_equiv")),
+          element(findColumn(columns, "type_symbol")),
+          charge(findColumn(columns, "pdbx_formal_charge")),
+          model(findColumn(columns, "pdbx_PDB_model_num")) {}
+
+    static std::string_view text(const Column* column, size_t row) {
+        return column ? column->text(row) : std::string_view();
+    }
+    static int integer(const Column* column, size_t row) {
+        return column ? column->integer(row) : 0;
+    }
+    static double real(const Column* column, size_t row) {
+        return column ? column->real(row) : 0.0;
+    }
+    int modelNumber(size_t row) const {
+        return model && model->present(row) ? model->integer(row) : 1;
+    }
+
+    const Column *group, *serial, *name, *altLoc, *resName, *chainID, *resSeq, *iCode;
+    const Column *x, *y, *z, *occupancy, *tempFactor, *element, *charge, *model;
+};
+
+void addAtoms(const AtomSiteColumns& columns, size_t begin, size_t end,
+              const ReaderOptions& options, int onlyModel, CifModelBuilder& builder) {
+    for (size_t row = begin; row < end; ++row) {
+        int number = columns.modelNumber(row);
+        if (onlyModel != CifModelBuilder::kAllModels && number != onlyModel) {
+            continue;
+        }
+        Reader::Records& records = builder.records(number);
+        records.foundData = true;
+
+        // Filter on identifiers before reading coordinates
+        bool het = AtomSiteColumns::text(columns.group, row) == "HETATM";
+        std::string_view name = AtomSiteColumns::text(columns.name, row);
+        std::string_view altLoc = AtomSiteColumns::text(columns.altLoc, row);
+        std::string_view resName = AtomSiteColumns::text(columns.resName, row);
+        std::string_view chainID = AtomSiteColumns::text(columns.chainID, row);
+        std::string_view iCode = AtomSiteColumns::text(columns.iCode, row);
+        std::string_view element = AtomSiteColumns::text(columns.element, row);
+        if (!builder.checkIdentifiers(name, altLoc, resName, chainID, iCode, element) ||
+            !options.acceptAtom(name, resName, het)) {
+            continue;
+        }
+
+        auto atom = records.arena.make<Atom>();
+        atom->serial = AtomSiteColumns::integer(columns.serial, row);
+        atom->name = name;
+        atom->altLoc = altLoc;
+        atom->resName = resName;
+        atom->chainID = chainID;
+        atom->resSeq = AtomSiteColumns::integer(columns.resSeq, row);
+        atom->iCode = iCode;
+        atom->x = AtomSiteColumns::real(columns.x, row);
+        atom->y = AtomSiteColumns::real(columns.y, row);
+        atom->z = AtomSiteColumns::real(columns.z, row);
+        atom->occupancy = AtomSiteColumns::real(columns.occupancy, row);
+        atom->tempFactor = AtomSiteColumns::real(columns.tempFactor, row);
+        atom->element = element;
+        atom->charge = CifModelBuilder::formalCharge(AtomSiteColumns::integer(columns.charge, row));
+        (het ? records.hetAtoms : records.atoms).push_back(atom);
+    }
+}
+
+void parseAtomSite(const MsgValue& category, const ReaderOptions& options,
+                   bool firstModelOnly, CifModelBuilder& builder) {
+    std::vector<Column> decoded;
+    size_t rows = decodeCategory(category, decoded);
+    AtomSiteColumns columns(decoded);
+    int onlyModel = (firstModelOnly && rows > 0) ? columns.modelNumber(0) : CifModelBuilder::kAllModels;
+
+    // Columns are random access, so rows split into ranges built in parallel
+    size_t chunks = parallel_thread_count(rows / kMinChunkRows, options.maxThreads);
+    std::vector<CifModelBuilder> parts(chunks);
+    parallel_for(chunks, [&](size_t i) {
+        addAtoms(columns, rows * i / chunks, rows * (i + 1) / chunks, options, onlyModel, parts[i]);
+    }, options.maxThreads);
+    for (auto& part : parts) {
+        builder.append(std::move(part));
+    }
+}
+
+void parseRows(std::string_view name, const MsgValue& category, CifModelBuilder& builder) {
+    std::vector<Column> columns;
+    size_t rows = decodeCategory(category, columns);
+
+    // CifModelBuilder reads text; numeric columns are formatted per row
+    std::deque<std::string> scratch;
+    for (size_t row = 0; row < rows; ++row) {
+        builder.addRow(name, [&](std::string_view item) -> std::string_view {
+            const Column* column = findColumn(columns, item);
+            if (!column || !column->present(row)) {
+                return {};
+            }
+            char text[32];
+            switch (column->values.kind) {
+            case Array::Kind::String:
+                return column->values.strings[row];
+            case Array::Kind::Int:
+                std::snprintf(text, sizeof(text), "%d", column->values.ints[row]);
+                break;
+            case Array::Kind::Float:
+                std::snprintf(text, sizeof(text), "%.17g", column->values.floats[row]);
+                break;
+            default:
+                return {};
+            }
+            scratch.emplace_back(text);
+            return scratch.back();
+        });
+        scratch.clear();
+    }
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<Model>> BinaryCifReader::readAll() {
+    return parse(false);
+}
+
+std::unique_ptr<Model> BinaryCifReader::read() {
+    auto models = parse(true);
+    return models.empty() ? nullptr : std::move(models.front());
+}
+
+std::vector<std::unique_ptr<Model>> BinaryCifReader::parse(bool firstModelOnly) {
+    warning_.clear();
+    MsgValue file;
+    MsgReader reader(buffer_);
+    if (!reader.read(file)) {
+        return {};
+    }
+    const MsgValue* blocks = file.find("dataBlocks");
+    if (!blocks || blocks->type != MsgValue::Type::Array || blocks->items.empty()) {
+        return {};
+    }
+    const MsgValue* categories = blocks->items[0].find("categories");
+    if (!categories || categories->type != MsgValue::Type::Array) {
+        return {};
+    }
+
+    // Only the first data block is read, as in CifReader
+    CifModelBuilder builder;
+    for (const auto& category : categories->items) {
+        const MsgValue* name = category.find("name");
+        if (!name) {
+            continue;
+        }
+        if (name->bytes == "_atom_site") {
+            parseAtomSite(category, options_, firstModelOnly, builder);
+        } else if (CifModelBuilder::readsCategory(name->bytes)) {
+            parseRows(name->bytes, category, builder);
+        }
+    }
+    auto models = builder.build(firstModelOnly, options_);
+    warning_ = builder.warning();
+    return models;
+}
+
+bool isBinaryCif(std::string_view buffer) {
+    if (buffer.empty()) {
+        return false;
+    }
+    uint8_t tag = static_cast<uint8_t>(buffer[0]);
+    bool map = (tag & 0xf0) == 0x80 || tag == 0xde || tag == 0xdf;
+    return map && buffer.substr(0, 4096).find("dataBlocks") != std::string_view::npos;
+}
+
+} // namespace pdb
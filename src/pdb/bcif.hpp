@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+
+namespace pdb {
+
+// Reader for BinaryCIF files: the mmCIF categories stored as MessagePack
+// with per-column codecs (ByteArray, FixedPoint, IntervalQuantization,
+// RunLength, Delta, IntegerPacking and StringArray). Builds the same Model
+// as CifReader. Columns are decoded straight into typed arrays; string
+// values point into the buffer, which must outlive the reader.
+class BinaryCifReader {
+public:
+    explicit BinaryCifReader(std::string_view buffer, const ReaderOptions& options = {})
+        : options_(options), buffer_(buffer) {}
+
+    // Reading methods; malformed input yields no models
+    std::vector<std::unique_ptr<Model>> readAll();
+    std::unique_ptr<Model> read();  // First model only
+    
+    // _atom_site rows the last read skipped for over-long identifiers
+    // (see CifModelBuilder::checkIdentifiers); empty if none
+    const std::string& warning() const { return warning_; }
+
+private:
+    std::vector<std::unique_ptr<Model>> parse(bool firstModelOnly);
+
+    ReaderOptions options_;
+    std::string_view buffer_;
+    std::string warning_;
+};
+
+// True if the buffer starts with a MessagePack map holding dataBlocks
+bool isBinaryCif(std::string_view buffer);
+
+} // namespace pdb
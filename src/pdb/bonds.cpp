@@ -0,0 +1,405 @@
+#include "pdb/bonds.hpp"
+#include "pdb/atom_table.hpp"
+#include "pdb/spatial.hpp"
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+namespace pdb {
+
+namespace {
+
+// Heavy-atom bonds of the standard amino acids beyond the shared backbone
+struct ResidueTemplate {
+    const char* resName;
+    const char* bonds;  // Space-separated "A-B" pairs
+};
+
+constexpr ResidueTemplate kTemplates[] = {
+    {"ALA", "CA-CB"},
+    {"ARG", "CA-CB CB-CG CG-CD CD-NE NE-CZ CZ-NH1 CZ-NH2"},
+    {"ASN", "CA-CB CB-CG CG-OD1 CG-ND2"},
+    {"ASP", "CA-CB CB-CG CG-OD1 CG-OD2"},
+    {"CYS", "CA-CB CB-SG"},
+    {"GLN", "CA-CB CB-CG CG-CD CD-OE1 CD-NE2"},
+    {"GLU", "CA-CB CB-CG CG-CD CD-OE1 CD-OE2"},
+    {"GLY", ""},
+    {"HIS", "CA-CB CB-CG CG-ND1 CG-CD2 ND1-CE1 CD2-NE2 CE1-NE2"},
+    {"ILE", "CA-CB CB-CG1 CB-CG2 CG1-CD1"},
+    {"LEU", "CA-CB CB-CG CG-CD1 CG-CD2"},
+    {"LYS", "CA-CB CB-CG CG-CD CD-CE CE-NZ"},
+    {"MET", "CA-CB CB-CG CG-SD SD-CE"},
+    {"MSE", "CA-CB CB-CG CG-SE SE-CE"},
+    {"PHE", "CA-CB CB-CG CG-CD1 CG-CD2 CD1-CE1 CD2-CE2 CE1-CZ CE2-CZ"},
+    {"PRO", "CA-CB CB-CG CG-CD CD-N"},
+    {"SER", "CA-CB CB-OG"},
+    {"THR", "CA-CB CB-OG1 CB-CG2"},
+    {"TRP", "CA-CB CB-CG CG-CD1 CG-CD2 CD1-NE1 NE1-CE2 CD2-CE2 CD2-CE3 CE2-CZ2 CE3-CZ3 CZ2-CH2 CZ3-CH2"},
+    {"TYR", "CA-CB CB-CG CG-CD1 CG-CD2 CD1-CE1 CD2-CE2 CE1-CZ CE2-CZ CZ-OH"},
+    {"VAL", "CA-CB CB-CG1 CB-CG2"},
+};
+
+constexpr const char* kBackbone = "N-CA CA-C C-O C-OXT";
+
+// Peptide C-N bonds are typically 1.33 A; longer gaps are chain breaks
+constexpr double kMaxPeptideBond = 2.0;
+
+// Closest two atoms can be and still count as bonded; anything nearer is
+// a duplicate or an unresolved alternate location
+constexpr float kMinBondLength = 0.4f;
+
+struct CovalentRadius {
+    const char* element;
+    float radius;
+};
+
+constexpr CovalentRadius kCovalentRadii[] = {
+    {"H", 0.31f}, {"D", 0.31f}, {"C", 0.76f}, {"N", 0.71f}, {"O", 0.66f},
+    {"F", 0.57f}, {"P", 1.07f}, {"S", 1.05f}, {"CL", 1.02f}, {"BR", 1.20f},
+    {"I", 1.39f}, {"SE", 1.20f}, {"B", 0.84f}, {"SI", 1.11f}, {"NA", 1.66f},
+    {"MG", 1.41f}, {"K", 2.03f}, {"CA", 1.76f}, {"MN", 1.39f}, {"FE", 1.32f},
+    {"CO", 1.26f}, {"NI", 1.24f}, {"CU", 1.32f}, {"ZN", 1.22f},
+};
+
+using NamePairs = std::vector<std::pair<Code, Code>>;
+
+void parsePairs(std::string_view text, NamePairs& pairs) {
+    while (!text.empty()) {
+        size_t end = std::min(text.find(' '), text.size());
+        std::string_view pair = text.substr(0, end);
+        size_t dash = pair.find('-');
+        if (dash != std::string_view::npos) {
+            pairs.emplace_back(Code(pair.substr(0, dash)), Code(pair.substr(dash + 1)));
+        }
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+}
+
+// Template bonds by residue name, backbone included; nullptr if unknown
+const NamePairs* templateBonds(Code resName) {
+    static const std::unordered_map<Code, NamePairs> templates = []() {
+        std::unordered_map<Code, NamePairs> result;
+        for (const ResidueTemplate& entry : kTemplates) {
+            NamePairs& pairs = result[Code(entry.resName)];
+            parsePairs(kBackbone, pairs);
+            parsePairs(entry.bonds, pairs);
+        }
+        return result;
+    }();
+    auto it = templates.find(resName);
+    return it == templates.end() ? nullptr : &it->second;
+}
+
+bool sameResidue(const Atom& a, const Atom& b) {
+    return a.chainID == b.chainID && a.resSeq == b.resSeq && a.iCode == b.iCode &&
+           a.resName == b.resName;
+}
+
+// Template and peptide bonds of modified residues such as MSE. They are
+// HETATM records, so the readers leave them in hetAtoms and out of
+// model.residues; here each run of hetAtoms rows with one residue and a
+// known template is linked to residues numbered one below and one above
+// in the same chain. residueRow(r, name) gives the row of an atom of
+// model.residues[r], or Residue::kNoAtom.
+template <typename ResidueRow>
+void addHetResidueBonds(const Model& model, ResidueRow&& residueRow,
+                        std::vector<BondGraph::Bond>& bonds) {
+    struct HetResidue {
+        uint32_t first, last;  // Range of hetAtoms
+    };
+    std::vector<HetResidue> hetResidues;
+    for (size_t i = 0; i < model.hetAtoms.size();) {
+        size_t end = i + 1;
+        while (end < model.hetAtoms.size() && sameResidue(*model.hetAtoms[end], *model.hetAtoms[i])) {
+            ++end;
+        }
+        if (templateBonds(model.hetAtoms[i]->resName)) {
+            hetResidues.push_back(HetResidue{uint32_t(i), uint32_t(end)});
+        }
+        i = end;
+    }
+    if (hetResidues.empty()) {
+        return;
+    }
+
+    const uint32_t hetBase = uint32_t(model.atoms.size());
+    auto atomAt = [&](uint32_t row) {
+        return row < hetBase ? model.atoms[row] : model.hetAtoms[row - hetBase];
+    };
+    auto hetRow = [&](const HetResidue& residue, Code name) {
+        for (uint32_t i = residue.first; i < residue.last; ++i) {
+            if (model.hetAtoms[i]->name == name) {
+                return hetBase + i;
+            }
+        }
+        return Residue::kNoAtom;
+    };
+
+    // Residues of both kinds by chain and number; the first one wins
+    struct Site {
+        bool het;
+        uint32_t index;
+    };
+    auto keyOf = [](Code chainID, int resSeq) {
+        return uint64_t(chainID.value()) << 32 | uint32_t(resSeq);
+    };
+    std::unordered_map<uint64_t, Site> sites;
+    for (size_t r = 0; r < model.residues.size(); ++r) {
+        sites.emplace(keyOf(model.residues[r]->chainID, model.residues[r]->resSeq), Site{false, uint32_t(r)});
+    }
+    for (size_t h = 0; h < hetResidues.size(); ++h) {
+        const Atom& atom = *model.hetAtoms[hetResidues[h].first];
+        sites.emplace(keyOf(atom.chainID, atom.resSeq), Site{true, uint32_t(h)});
+    }
+    auto siteRow = [&](const Site& site, Code name) {
+        return site.het ? hetRow(hetResidues[site.index], name) : residueRow(site.index, name);
+    };
+    auto addPeptideBond = [&](uint32_t c, uint32_t n) {
+        if (c == Residue::kNoAtom || n == Residue::kNoAtom) {
+            return;
+        }
+        const Atom* a = atomAt(c);
+        const Atom* b = atomAt(n);
+        double dx = a->x - b->x;
+        double dy = a->y - b->y;
+        double dz = a->z - b->z;
+        if (dx * dx + dy * dy + dz * dz <= kMaxPeptideBond * kMaxPeptideBond) {
+            bonds.emplace_back(c, n);
+        }
+    };
+
+    for (const HetResidue& residue : hetResidues) {
+        const Atom& atom = *model.hetAtoms[residue.first];
+        for (const auto& pair : *templateBonds(atom.resName)) {
+            uint32_t a = hetRow(residue, pair.first);
+            uint32_t b = hetRow(residue, pair.second);
+            if (a != Residue::kNoAtom && b != Residue::kNoAtom) {
+                bonds.emplace_back(a, b);
+            }
+        }
+        auto previous = sites.find(keyOf(atom.chainID, atom.resSeq - 1));
+        if (previous != sites.end()) {
+            addPeptideBond(siteRow(previous->second, "C"), hetRow(residue, "N"));
+        }
+        auto next = sites.find(keyOf(atom.chainID, atom.resSeq + 1));
+        if (next != sites.end()) {
+            addPeptideBond(hetRow(residue, "C"), siteRow(next->second, "N"));
+        }
+    }
+}
+
+} // namespace
+
+BondGraph::BondGraph(size_t atomCount, const std::vector<Bond>& bonds)
+    : offsets_(atomCount + 1, 0) {
+    auto valid = [atomCount](const Bond& bond) {
+        return bond.first != bond.second && bond.first < atomCount && bond.second < atomCount;
+    };
+
+    // Count degrees, then scatter both directions of every bond
+    for (const Bond& bond : bonds) {
+        if (valid(bond)) {
+            ++offsets_[bond.first + 1];
+            ++offsets_[bond.second + 1];
+        }
+    }
+    for (size_t i = 0; i < atomCount; ++i) {
+        offsets_[i + 1] += offsets_[i];
+    }
+    adjacency_.resize(offsets_[atomCount]);
+    std::vector<uint32_t> cursor(offsets_.begin(), offsets_.end() - 1);
+    for (const Bond& bond : bonds) {
+        if (valid(bond)) {
+            adjacency_[cursor[bond.first]++] = bond.second;
+            adjacency_[cursor[bond.second]++] = bond.first;
+        }
+    }
+
+    // Sort each row and drop repeats, compacting in place
+    uint32_t out = 0;
+    for (size_t i = 0; i < atomCount; ++i) {
+        auto first = adjacency_.begin() + offsets_[i];
+        auto last = adjacency_.begin() + offsets_[i + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        offsets_[i] = out;
+        out = uint32_t(std::copy(first, last, adjacency_.begin() + out) - adjacency_.begin());
+    }
+    offsets_[atomCount] = out;
+    adjacency_.resize(out);
+    adjacency_.shrink_to_fit();
+}
+
+BondGraph BondGraph::fromModel(const Model& model) {
+    size_t atomCount = model.atoms.size() + model.hetAtoms.size();
+    std::vector<Bond> bonds = model.resolveConnections();
+
+    // Row of each residue's first atom. Readers build residues from
+    // consecutive runs of model.atoms; anything else goes through a map.
+    std::vector<uint32_t> firstRow(model.residues.size());
+    bool contiguous = true;
+    size_t cursor = 0;
+    for (size_t r = 0; r < model.residues.size() && contiguous; ++r) {
+        const auto& atoms = model.residues[r]->atoms;
+        contiguous = cursor + atoms.size() <= model.atoms.size();
+        for (size_t j = 0; j < atoms.size() && contiguous; ++j) {
+            contiguous = model.atoms[cursor + j] == atoms[j];
+        }
+        firstRow[r] = uint32_t(cursor);
+        cursor += atoms.size();
+    }
+    std::unordered_map<const Atom*, uint32_t> rows;
+    if (!contiguous) {
+        rows.reserve(atomCount);
+        for (size_t i = 0; i < model.atoms.size(); ++i) {
+            rows.emplace(model.atoms[i], uint32_t(i));
+        }
+        for (size_t i = 0; i < model.hetAtoms.size(); ++i) {
+            rows.emplace(model.hetAtoms[i], uint32_t(model.atoms.size() + i));
+        }
+    }
+    auto rowOf = [&](size_t r, uint32_t index) {
+        if (contiguous) {
+            return firstRow[r] + index;
+        }
+        auto it = rows.find(model.residues[r]->atoms[index]);
+        return it == rows.end() ? Residue::kNoAtom : it->second;
+    };
+    auto addBond = [&](size_t ra, uint32_t a, size_t rb, uint32_t b) {
+        if (a != Residue::kNoAtom && b != Residue::kNoAtom) {
+            bonds.emplace_back(rowOf(ra, a), rowOf(rb, b));
+        }
+    };
+
+    for (size_t r = 0; r < model.residues.size(); ++r) {
+        const Residue& residue = *model.residues[r];
+        if (const NamePairs* pairs = templateBonds(residue.resName)) {
+            for (const auto& pair : *pairs) {
+                addBond(r, residue.indexOf(pair.first), r, residue.indexOf(pair.second));
+            }
+        }
+
+        // Peptide bond to the previous residue of the same chain
+        if (r == 0) {
+            continue;
+        }
+        const Residue& previous = *model.residues[r - 1];
+        const Atom* c = previous.c();
+        const Atom* n = residue.n();
+        if (previous.chainID != residue.chainID || !c || !n) {
+            continue;
+        }
+        double dx = c->x - n->x;
+        double dy = c->y - n->y;
+        double dz = c->z - n->z;
+        if (dx * dx + dy * dy + dz * dz <= kMaxPeptideBond * kMaxPeptideBond) {
+            addBond(r - 1, previous.indexOf("C"), r, residue.indexOf("N"));
+        }
+    }
+
+    addHetResidueBonds(model, [&](size_t r, Code name) {
+        uint32_t index = model.residues[r]->indexOf(name);
+        return index == Residue::kNoAtom ? index : rowOf(r, index);
+    }, bonds);
+
+    return BondGraph(atomCount, bonds);
+}
+
+void BondGraph::addBonds(const std::vector<Bond>& bonds) {
+    std::vector<Bond> all = edges();
+    all.insert(all.end(), bonds.begin(), bonds.end());
+    *this = BondGraph(atomCount(), all);
+}
+
+bool BondGraph::bonded(uint32_t a, uint32_t b) const {
+    if (a >= atomCount()) {
+        return false;
+    }
+    Neighbors row = neighbors(a);
+    return std::binary_search(row.begin(), row.end(), b);
+}
+
+std::vector<BondGraph::Bond> BondGraph::edges() const {
+    std::vector<Bond> result;
+    result.reserve(bondCount());
+    for (uint32_t a = 0; a < atomCount(); ++a) {
+        for (uint32_t b : neighbors(a)) {
+            if (a < b) {
+                result.emplace_back(a, b);
+            }
+        }
+    }
+    return result;
+}
+
+float covalentRadius(Code element) {
+    for (const CovalentRadius& entry : kCovalentRadii) {
+        if (element == Code(entry.element)) {
+            return entry.radius;
+        }
+    }
+    return 0.76f;
+}
+
+std::vector<BondGraph::Bond> perceiveBonds(const AtomTable& table, float tolerance, size_t maxThreads) {
+    size_t count = table.size();
+    if (count < 2) {
+        return {};
+    }
+
+    // Radii per element, looked up once per distinct element
+    std::unordered_map<Code, float> radii;
+    auto radiusOf = [&](size_t row) {
+        Code element = table.element[row];
+        if (element.empty()) {
+            Code name = table.name[row];
+            size_t i = 0;
+            while (i < name.size() && !std::isalpha(static_cast<unsigned char>(name[i]))) {
+                ++i;
+            }
+            char symbol = i < name.size() ? name[i] : ' ';
+            element = Code(std::string_view(&symbol, 1));
+        }
+        auto it = radii.find(element);
+        if (it == radii.end()) {
+            it = radii.emplace(element, covalentRadius(element)).first;
+        }
+        return it->second;
+    };
+
+    std::vector<float> radius(count);
+    float maxRadius = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        radius[i] = radiusOf(i);
+        maxRadius = std::max(maxRadius, radius[i]);
+    }
+
+    // Cells as large as the longest possible bond, so only the half shell
+    // of neighbouring cells after each atom needs testing. Radius and
+    // alternate location are gathered into grid order for the pair test.
+    float cutoff = 2.0f * maxRadius + tolerance;
+    CellGrid grid(table, cutoff);
+    struct BondAtom {
+        float radius;
+        char altLoc;
+    };
+    std::vector<BondAtom> atoms(count);
+    for (size_t slot = 0; slot < count; ++slot) {
+        uint32_t row = grid.rowAt(slot);
+        atoms[slot] = BondAtom{radius[row], table.altLoc[row]};
+    }
+    radius.clear();
+    radius.shrink_to_fit();
+
+    return grid.pairsWithin(cutoff, [&](uint32_t a, uint32_t b, float distance2) {
+        const BondAtom& first = atoms[a];
+        const BondAtom& second = atoms[b];
+        float limit = first.radius + second.radius + tolerance;
+        if (distance2 > limit * limit || distance2 < kMinBondLength * kMinBondLength) {
+            return false;
+        }
+        return first.altLoc == ' ' || second.altLoc == ' ' || first.altLoc == second.altLoc;
+    }, maxThreads);
+}
+
+} // namespace pdb
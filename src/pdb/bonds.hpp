@@ -0,0 +1,78 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+
+namespace pdb {
+
+class AtomTable;
+
+// Undirected bond graph over atom rows in Model order (atoms, then
+// hetAtoms), stored as compressed sparse rows: the neighbours of row i are
+// adjacency()[offsets()[i], offsets()[i + 1]), sorted and without repeats.
+class BondGraph {
+public:
+    using Bond = std::pair<uint32_t, uint32_t>;
+
+    // Neighbours of one row
+    struct Neighbors {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return size_t(last - first); }
+        bool empty() const { return first == last; }
+        uint32_t operator[](size_t i) const { return first[i]; }
+    };
+
+    // Constructors
+    BondGraph() : offsets_(1, 0) {}
+    // Bonds may be listed in either direction and more than once;
+    // self-bonds and rows past atomCount are ignored
+    BondGraph(size_t atomCount, const std::vector<Bond>& bonds);
+
+    // CONECT records plus intra-residue bonds from the built-in amino acid
+    // templates and C-N peptide bonds between consecutive residues of a
+    // chain that are close enough to be linked. Modified residues stored as
+    // HETATM records (e.g. MSE) get their template and peptide bonds too.
+    static BondGraph fromModel(const Model& model);
+
+    size_t atomCount() const { return offsets_.size() - 1; }
+    size_t bondCount() const { return adjacency_.size() / 2; }
+    Neighbors neighbors(uint32_t row) const {
+        return Neighbors{adjacency_.data() + offsets_[row], adjacency_.data() + offsets_[row + 1]};
+    }
+    bool bonded(uint32_t a, uint32_t b) const;
+
+    // Merges more bonds into the graph, e.g. from perceiveBonds
+    void addBonds(const std::vector<Bond>& bonds);
+
+    // Each bond once, as (lower row, higher row) in row order
+    std::vector<Bond> edges() const;
+
+    // Raw CSR arrays, e.g. for upload to the GPU
+    const std::vector<uint32_t>& offsets() const { return offsets_; }
+    const std::vector<uint32_t>& adjacency() const { return adjacency_; }
+
+private:
+    std::vector<uint32_t> offsets_;    // atomCount() + 1 entries
+    std::vector<uint32_t> adjacency_;  // Both directions of every bond
+};
+
+// Covalent radius in angstroms by element symbol (Cordero et al. 2008);
+// 0.76 (carbon) for elements not in the table
+float covalentRadius(Code element);
+
+// Infers bonds from distances: two atoms are bonded if they are between
+// 0.4 A and the sum of their covalent radii plus tolerance apart, unless
+// they sit in different alternate locations. Atoms are binned into a
+// CellGrid with cells as large as the longest possible bond, so each atom
+// is only tested against its own and the neighbouring cells, and the
+// search is split across up to maxThreads threads (0: one per core). Atoms
+// with a blank element column use the first letter of their name. Returns
+// each bond once, as row pairs of table.
+std::vector<BondGraph::Bond> perceiveBonds(const AtomTable& table, float tolerance = 0.45f,
+                                           size_t maxThreads = 0);
+
+} // namespace pdb
@@ -0,0 +1,532 @@
+#include "pdb/cache.hpp"
+#include "pdb/bcif.hpp"
+#include "pdb/cif.hpp"
+#include "utils/gzip_stream.hpp"
+#include "utils/mapped_file.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <unistd.h>
+
+namespace pdb {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'G', 'L', 'C'};
+constexpr uint32_t kVersion = 6;
+constexpr uint32_t kByteOrder = 0x01020304;
+constexpr size_t kHashWindow = 64 * 1024;
+
+static_assert(std::is_trivially_copyable<Atom>::value, "Atom is stored as raw bytes");
+static_assert(std::is_trivially_copyable<Helix>::value, "Helix is stored as raw bytes");
+static_assert(std::is_trivially_copyable<Strand>::value, "Strand is stored as raw bytes");
+static_assert(std::is_trivially_copyable<Connection>::value, "Connection is stored as raw bytes");
+
+enum Section {
+    Atoms = 0,
+    HetAtoms,
+    Connections,
+    Helixes,
+    Strands,
+    BioMatrixes,
+    SymMatrixes,
+    Residues,
+    ResidueAtoms,   // Atom indices (atoms, then hetAtoms) of every residue
+    Chains,
+    ChainResidues,  // Residue indices of every chain
+    SectionCount
+};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t atomSize;
+    uint32_t helixSize;
+    uint32_t strandSize;
+    uint32_t connectionSize;
+    uint32_t pathLength;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    uint64_t options;
+    uint64_t counts[SectionCount];
+};
+
+struct ResidueRecord {
+    uint32_t first;  // Offset into ResidueAtoms
+    uint32_t count;
+    int32_t type;
+    uint32_t reserved;
+};
+
+struct ChainRecord {
+    uint32_t first;  // Offset into ChainResidues
+    uint32_t count;
+};
+
+constexpr size_t kRecordSize[SectionCount] = {
+    sizeof(Atom), sizeof(Atom), sizeof(Connection), sizeof(Helix), sizeof(Strand),
+    sizeof(Matrix), sizeof(Matrix), sizeof(ResidueRecord), sizeof(uint32_t),
+    sizeof(ChainRecord), sizeof(uint32_t)
+};
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+uint64_t fnv1a(const void* data, size_t length, uint64_t hash = 1469598103934665603ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t optionsFingerprint(const ReaderOptions& options) {
+    return uint64_t(options.atoms) |
+           uint64_t(options.skipHetAtoms) << 8 |
+           uint64_t(options.skipWater) << 9 |
+           uint64_t(options.skipConnections) << 10 |
+           uint64_t(static_cast<unsigned char>(options.altLoc)) << 16;
+}
+
+// Appends raw records to a sink taking (const char*, size_t), padded to
+// 8 bytes
+template <typename Sink>
+class SectionWriter {
+public:
+    explicit SectionWriter(Sink& sink) : sink_(sink) {}
+
+    void write(const void* data, size_t bytes) {
+        static const char zeros[8] = {};
+        sink_(static_cast<const char*>(data), bytes);
+        sink_(zeros, padded(bytes) - bytes);
+    }
+
+    template <typename T>
+    void write(const std::vector<T>& records) {
+        write(records.data(), records.size() * sizeof(T));
+    }
+
+    // Records held by pointer, back to back
+    template <typename T>
+    void writeObjects(const std::vector<T>& objects) {
+        static const char zeros[8] = {};
+        for (const auto& object : objects) {
+            sink_(reinterpret_cast<const char*>(&*object), sizeof(*object));
+        }
+        size_t bytes = objects.size() * sizeof(*objects.front());
+        sink_(zeros, padded(bytes) - bytes);
+    }
+
+private:
+    Sink& sink_;
+};
+
+// Picks the reader from the file contents
+std::unique_ptr<Model> readBuffer(std::string_view buffer, const ReaderOptions& options) {
+    if (isBinaryCif(buffer)) {
+        return BinaryCifReader(buffer, options).read();
+    }
+    if (isCif(buffer)) {
+        return CifReader(buffer, options).read();
+    }
+    return Reader(buffer, options).read();
+}
+
+// PDB text is parsed line by line while the producer thread inflates
+// ahead; mmCIF readers need the whole text, so it is collected first
+std::unique_ptr<Model> readCompressed(std::string_view compressed, const ReaderOptions& options) {
+    GzipStream stream(compressed);
+    std::string_view head = stream.buffer().peek_chunk();
+    std::unique_ptr<Model> model;
+    if (isBinaryCif(head) || isCif(head)) {
+        std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if (stream.ok()) {
+            model = readBuffer(text, options);
+        }
+    } else {
+        model = Reader(stream, options).read();
+    }
+    return stream.ok() ? std::move(model) : nullptr;
+}
+
+} // namespace
+
+bool CacheKey::forFile(const std::string& path, const ReaderOptions& options, CacheKey& key) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    if (ec) {
+        return false;
+    }
+    uint64_t size = fs::file_size(absolute, ec);
+    if (ec) {
+        return false;
+    }
+    auto mtime = fs::last_write_time(absolute, ec);
+    if (ec) {
+        return false;
+    }
+
+    // Hash the size plus the head and tail of the file
+    std::ifstream in(absolute, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<char> window(std::min<uint64_t>(size, kHashWindow));
+    uint64_t hash = fnv1a(&size, sizeof(size));
+    in.read(window.data(), window.size());
+    hash = fnv1a(window.data(), in.gcount(), hash);
+    if (size > kHashWindow) {
+        in.clear();
+        in.seekg(size - window.size());
+        in.read(window.data(), window.size());
+        hash = fnv1a(window.data(), in.gcount(), hash);
+    }
+
+    key.sourcePath = absolute.string();
+    key.size = size;
+    key.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    key.hash = hash;
+    key.options = optionsFingerprint(options);
+    return true;
+}
+
+namespace {
+
+// Serializes model into sink, a callable taking (const char*, size_t);
+// returns false if the residue or chain graph refers outside the model
+template <typename Sink>
+bool encodeImage(const Model& model, const CacheKey& key, Sink& sink) {
+    // Flatten the residue and chain graphs into index lists
+    std::unordered_map<const Atom*, uint32_t> atomIndex;
+    atomIndex.reserve(model.atoms.size() + model.hetAtoms.size());
+    for (const auto& atom : model.atoms) {
+        atomIndex.emplace(atom, static_cast<uint32_t>(atomIndex.size()));
+    }
+    for (const auto& atom : model.hetAtoms) {
+        atomIndex.emplace(atom, static_cast<uint32_t>(atomIndex.size()));
+    }
+
+    std::unordered_map<const Residue*, uint32_t> residueIndex;
+    std::vector<ResidueRecord> residues;
+    std::vector<uint32_t> residueAtoms;
+    for (const auto& residue : model.residues) {
+        residueIndex.emplace(residue, static_cast<uint32_t>(residues.size()));
+        ResidueRecord record{static_cast<uint32_t>(residueAtoms.size()),
+                             static_cast<uint32_t>(residue->atoms.size()),
+                             static_cast<int32_t>(residue->type), 0};
+        for (const auto& atom : residue->atoms) {
+            auto it = atomIndex.find(atom);
+            if (it == atomIndex.end()) {
+                return false; // Residue refers to an atom outside the model
+            }
+            residueAtoms.push_back(it->second);
+        }
+        residues.push_back(record);
+    }
+
+    std::vector<ChainRecord> chains;
+    std::vector<uint32_t> chainResidues;
+    for (const auto& chain : model.chains) {
+        ChainRecord record{static_cast<uint32_t>(chainResidues.size()),
+                           static_cast<uint32_t>(chain->residues.size())};
+        for (const auto& residue : chain->residues) {
+            auto it = residueIndex.find(residue);
+            if (it == residueIndex.end()) {
+                return false;
+            }
+            chainResidues.push_back(it->second);
+        }
+        chains.push_back(record);
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.atomSize = sizeof(Atom);
+    header.helixSize = sizeof(Helix);
+    header.strandSize = sizeof(Strand);
+    header.connectionSize = sizeof(Connection);
+    header.pathLength = static_cast<uint32_t>(key.sourcePath.size());
+    header.sourceSize = key.size;
+    header.sourceMtime = key.mtime;
+    header.sourceHash = key.hash;
+    header.options = key.options;
+    header.counts[Atoms] = model.atoms.size();
+    header.counts[HetAtoms] = model.hetAtoms.size();
+    header.counts[Connections] = model.connections.size();
+    header.counts[Helixes] = model.helixes.size();
+    header.counts[Strands] = model.strands.size();
+    header.counts[BioMatrixes] = model.bioMatrixes.size();
+    header.counts[SymMatrixes] = model.symMatrixes.size();
+    header.counts[Residues] = residues.size();
+    header.counts[ResidueAtoms] = residueAtoms.size();
+    header.counts[Chains] = chains.size();
+    header.counts[ChainResidues] = chainResidues.size();
+
+    SectionWriter<Sink> writer(sink);
+    writer.write(&header, sizeof(header));
+    writer.write(key.sourcePath.data(), key.sourcePath.size());
+    writer.writeObjects(model.atoms);
+    writer.writeObjects(model.hetAtoms);
+    writer.write(model.connections);
+    writer.writeObjects(model.helixes);
+    writer.writeObjects(model.strands);
+    writer.write(model.bioMatrixes);
+    writer.write(model.symMatrixes);
+    writer.write(residues);
+    writer.write(residueAtoms);
+    writer.write(chains);
+    writer.write(chainResidues);
+    return true;
+}
+
+// Rebuilds a model from an image, checking it against key if given
+std::unique_ptr<Model> decodeImage(std::string_view image, const CacheKey* key) {
+    if (image.size() < sizeof(FileHeader)) {
+        return nullptr;
+    }
+
+    // Validate the header against this build and, if given, the source
+    FileHeader header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion || header.byteOrder != kByteOrder ||
+        header.atomSize != sizeof(Atom) || header.helixSize != sizeof(Helix) ||
+        header.strandSize != sizeof(Strand) || header.connectionSize != sizeof(Connection)) {
+        return nullptr;
+    }
+    if (key && (header.sourceSize != key->size || header.sourceMtime != key->mtime ||
+                header.sourceHash != key->hash || header.options != key->options ||
+                header.pathLength != key->sourcePath.size())) {
+        return nullptr;
+    }
+
+    size_t offset = padded(sizeof(header));
+    if (image.size() < offset + header.pathLength ||
+        (key && std::string_view(image.data() + offset, header.pathLength) != key->sourcePath)) {
+        return nullptr;
+    }
+    offset += padded(header.pathLength);
+
+    const char* sections[SectionCount];
+    for (size_t s = 0; s < SectionCount; ++s) {
+        if (header.counts[s] > image.size() / kRecordSize[s]) {
+            return nullptr;
+        }
+        size_t bytes = padded(header.counts[s] * kRecordSize[s]);
+        if (image.size() - offset < bytes) {
+            return nullptr;
+        }
+        sections[s] = image.data() + offset;
+        offset += bytes;
+    }
+
+    auto model = std::make_unique<Model>();
+    auto readObjects = [&](Section s, auto& objects) {
+        using T = typename std::decay_t<decltype(objects)>::value_type::element_type;
+        objects.reserve(header.counts[s]);
+        for (size_t i = 0; i < header.counts[s]; ++i) {
+            auto object = std::make_unique<T>();
+            std::memcpy(static_cast<void*>(object.get()), sections[s] + i * sizeof(T), sizeof(T));
+            objects.push_back(std::move(object));
+        }
+    };
+    auto readArray = [&](Section s, auto& values) {
+        using T = typename std::decay_t<decltype(values)>::value_type;
+        values.resize(header.counts[s]);
+        if (values.empty()) {
+            return;
+        }
+        std::memcpy(static_cast<void*>(values.data()), sections[s], values.size() * sizeof(T));
+    };
+    auto readAtoms = [&](Section s, std::vector<Atom*>& atoms) {
+        atoms.reserve(header.counts[s]);
+        model->arena.atoms.reserve(header.counts[s]);
+        for (size_t i = 0; i < header.counts[s]; ++i) {
+            auto atom = model->arena.make<Atom>();
+            std::memcpy(static_cast<void*>(atom), sections[s] + i * sizeof(Atom), sizeof(Atom));
+            atoms.push_back(atom);
+        }
+    };
+    readAtoms(Atoms, model->atoms);
+    readAtoms(HetAtoms, model->hetAtoms);
+    readArray(Connections, model->connections);
+    readObjects(Helixes, model->helixes);
+    readObjects(Strands, model->strands);
+    readArray(BioMatrixes, model->bioMatrixes);
+    readArray(SymMatrixes, model->symMatrixes);
+
+    std::vector<ResidueRecord> residues;
+    std::vector<uint32_t> residueAtoms;
+    std::vector<ChainRecord> chains;
+    std::vector<uint32_t> chainResidues;
+    readArray(Residues, residues);
+    readArray(ResidueAtoms, residueAtoms);
+    readArray(Chains, chains);
+    readArray(ChainResidues, chainResidues);
+
+    // Rebuild residues and chains from the stored index lists
+    model->arena.residues.reserve(residues.size());
+    model->arena.chains.reserve(chains.size());
+    size_t atomCount = model->atoms.size() + model->hetAtoms.size();
+    std::vector<Atom*> group;
+    for (const auto& record : residues) {
+        if (record.first + uint64_t(record.count) > residueAtoms.size()) {
+            return nullptr;
+        }
+        group.clear();
+        for (uint32_t i = record.first; i < record.first + record.count; ++i) {
+            uint32_t index = residueAtoms[i];
+            if (index >= atomCount) {
+                return nullptr;
+            }
+            group.push_back(index < model->atoms.size() ? model->atoms[index]
+                                                        : model->hetAtoms[index - model->atoms.size()]);
+        }
+        auto residue = Residue::create(group, model->arena);
+        if (!residue) {
+            return nullptr;
+        }
+        residue->type = static_cast<ResidueType>(record.type);
+        model->residues.push_back(residue);
+    }
+
+    std::vector<Residue*> residueGroup;
+    for (const auto& record : chains) {
+        if (record.first + uint64_t(record.count) > chainResidues.size()) {
+            return nullptr;
+        }
+        residueGroup.clear();
+        for (uint32_t i = record.first; i < record.first + record.count; ++i) {
+            if (chainResidues[i] >= model->residues.size()) {
+                return nullptr;
+            }
+            residueGroup.push_back(model->residues[chainResidues[i]]);
+        }
+        auto chain = Chain::create(residueGroup, model->arena);
+        if (!chain) {
+            return nullptr;
+        }
+        model->chains.push_back(chain);
+    }
+    model->indexChains();
+
+    return model;
+}
+
+} // namespace
+
+bool encodeModel(const Model& model, const CacheKey& key, std::string& image) {
+    image.clear();
+    auto append = [&image](const char* data, size_t bytes) { image.append(data, bytes); };
+    return encodeImage(model, key, append);
+}
+
+std::unique_ptr<Model> decodeModel(std::string_view image) {
+    return decodeImage(image, nullptr);
+}
+
+std::string temporaryPathFor(const std::string& path) {
+    // The process ID separates processes on one host, the random token hosts
+    // sharing a cache directory, and the counter calls within a process
+    static const uint32_t token = std::random_device()();
+    static std::atomic<uint64_t> counter{0};
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%ld.%08x.%llu.tmp", long(getpid()), unsigned(token),
+                  static_cast<unsigned long long>(counter++));
+    return path + suffix;
+}
+
+bool writeModelCache(const Model& model, const CacheKey& key, const std::string& path) {
+    // Write to a private temporary file and rename, so readers never see a
+    // partial entry; the last complete writer wins
+    std::string tempPath = temporaryPathFor(path);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        auto write = [&out](const char* data, size_t bytes) { out.write(data, bytes); };
+        if (!encodeImage(model, key, write) || !out) {
+            out.close();
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<Model> readModelCache(const std::string& path, const CacheKey& key) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return nullptr;
+    }
+    return decodeImage(file.view(), &key);
+}
+
+std::string defaultCacheDir() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return (fs::path(xdg) / "foldgl").string();
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return (fs::path(home) / ".cache" / "foldgl").string();
+    }
+    return "";
+}
+
+std::unique_ptr<Model> loadCached(const std::string& path,
+                                  const ReaderOptions& options,
+                                  const std::string& cacheDir) {
+    CacheKey key;
+    std::string cachePath;
+    if (!cacheDir.empty() && CacheKey::forFile(path, options, key)) {
+        // One entry per source path and option set
+        uint64_t name = fnv1a(key.sourcePath.data(), key.sourcePath.size());
+        name = fnv1a(&key.options, sizeof(key.options), name);
+        char fileName[32];
+        std::snprintf(fileName, sizeof(fileName), "%016llx.fgl", static_cast<unsigned long long>(name));
+        cachePath = (fs::path(cacheDir) / fileName).string();
+
+        if (auto model = readModelCache(cachePath, key)) {
+            return model;
+        }
+    }
+
+    MappedFile file(path);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    std::unique_ptr<Model> model = is_gzip(file.view()) ? readCompressed(file.view(), options)
+                                                         : readBuffer(file.view(), options);
+
+    if (model && !cachePath.empty()) {
+        std::error_code ec;
+        fs::create_directories(cacheDir, ec);
+        writeModelCache(*model, key, cachePath);
+    }
+    return model;
+}
+
+} // namespace pdb
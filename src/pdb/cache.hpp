@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+
+namespace pdb {
+
+// Identifies the source a cached model was parsed from. Entries are reused
+// only when every field matches.
+struct CacheKey {
+    std::string sourcePath;  // Absolute path of the source file
+    uint64_t size{0};
+    int64_t mtime{0};        // Last write time, filesystem clock ticks
+    uint64_t hash{0};        // Hash of the size and the first/last 64 KiB
+    uint64_t options{0};     // Fingerprint of the ReaderOptions used
+
+    // Builds the key for a file on disk; returns false if it cannot be read
+    static bool forFile(const std::string& path, const ReaderOptions& options, CacheKey& key);
+};
+
+// Versioned binary snapshot of a Model (.fgl). Atom, residue, chain,
+// helix, strand, connection and BIOMT/SMTRY sections are stored as raw
+// arrays, so loading maps the file and copies records without parsing.
+// Files are only valid on the architecture and build that wrote them; a
+// header check rejects anything else.
+bool writeModelCache(const Model& model, const CacheKey& key, const std::string& path);
+std::unique_ptr<Model> readModelCache(const std::string& path, const CacheKey& key);
+
+// The same snapshot in memory, for containers such as Archive.
+// decodeModel checks the build fields of the header but not the source.
+bool encodeModel(const Model& model, const CacheKey& key, std::string& image);
+std::unique_ptr<Model> decodeModel(std::string_view image);
+
+// Name to write path under before renaming it into place. Unique per call,
+// also across processes, so concurrent writers of the same path never share
+// a temporary file.
+std::string temporaryPathFor(const std::string& path);
+
+// Default cache directory: $XDG_CACHE_HOME/foldgl or ~/.cache/foldgl
+std::string defaultCacheDir();
+
+// Reads the first model of a PDB, mmCIF or BinaryCIF file, optionally
+// gzip-compressed, through the cache: a valid cache
+// entry is loaded directly, otherwise the file is parsed and the entry
+// written for next time. An empty cacheDir disables caching.
+std::unique_ptr<Model> loadCached(const std::string& path,
+                                  const ReaderOptions& options = {},
+                                  const std::string& cacheDir = defaultCacheDir());
+
+} // namespace pdb
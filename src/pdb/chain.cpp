@@ -1,32 +1,33 @@
 #include "pdb/chain.hpp"
+#include "pdb/arena.hpp"
 
 namespace pdb {
 
-std::unique_ptr<Chain> Chain::create(const std::vector<std::shared_ptr<Residue>>& residues) {
+Chain* Chain::create(const std::vector<Residue*>& residues, ModelArena& arena) {
     if (residues.empty()) {
         return nullptr;
     }
     
-    auto chain = std::make_unique<Chain>();
+    auto chain = arena.make<Chain>();
     chain->chainID = residues[0]->chainID;
     chain->residues = residues;
     
     return chain;
 }
 
-std::vector<std::unique_ptr<Chain>> 
-chainsForResidues(const std::vector<std::shared_ptr<Residue>>& residues) {
-    std::vector<std::unique_ptr<Chain>> chains;
-    std::vector<std::shared_ptr<Residue>> group;
-    std::string previous = "";
+std::vector<Chain*> 
+chainsForResidues(const std::vector<Residue*>& residues, ModelArena& arena) {
+    std::vector<Chain*> chains;
+    std::vector<Residue*> group;
+    Code previous;
     
     // Group residues by chain ID
     for (const auto& residue : residues) {
-        std::string value = residue->chainID;
+        Code value = residue->chainID;
         if (value != previous && !group.empty()) {
-            auto chain = Chain::create(group);
+            auto chain = Chain::create(group, arena);
             if (chain) {
-                chains.push_back(std::move(chain));
+                chains.push_back(chain);
             }
             group.clear();
         }
@@ -36,9 +37,9 @@ chainsForResidues(const std::vector<std::shared_ptr<Residue>>& residues) {
     
     // Handle the last group
     if (!group.empty()) {
-        auto chain = Chain::create(group);
+        auto chain = Chain::create(group, arena);
         if (chain) {
-            chains.push_back(std::move(chain));
+            chains.push_back(chain);
         }
     }
     
@@ -5,21 +5,23 @@
 
 namespace pdb {
 
+class ModelArena;
+
 class Chain {
 public:
     // Constructor
     Chain() = default;
     
-    // Factory method
-    static std::unique_ptr<Chain> create(const std::vector<std::shared_ptr<Residue>>& residues);
+    // Factory method; the chain is allocated in arena
+    static Chain* create(const std::vector<Residue*>& residues, ModelArena& arena);
     
     // Data members
-    std::string chainID;
-    std::vector<std::shared_ptr<Residue>> residues;
+    Code chainID;
+    std::vector<Residue*> residues;
 };
 
 // Factory function for creating chains from residues
-std::vector<std::unique_ptr<Chain>> 
-chainsForResidues(const std::vector<std::shared_ptr<Residue>>& residues);
+std::vector<Chain*> 
+chainsForResidues(const std::vector<Residue*>& residues, ModelArena& arena);
 
 } // namespace pdb
@@ -0,0 +1,719 @@
+#include "pdb/cif.hpp"
+#include "pdb/atom.hpp"
+#include "pdb/secondary_structure.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace pdb {
+
+namespace {
+
+// _atom_site loops smaller than this are parsed on one thread
+constexpr size_t kMinChunkBytes = size_t(4) << 20;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Case-insensitive prefix test against a lowercase keyword
+bool startsWithKeyword(std::string_view token, std::string_view keyword) {
+    if (token.size() < keyword.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < keyword.size(); ++i) {
+        char c = token[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Unquoted tokens that end a loop body: tags and reserved words
+bool isTagOrReserved(std::string_view token) {
+    switch (token[0]) {
+    case '_':
+        return true;
+    case 'd': case 'D':
+        return startsWithKeyword(token, "data_");
+    case 'l': case 'L':
+        return startsWithKeyword(token, "loop_");
+    case 's': case 'S':
+        return startsWithKeyword(token, "save_") || startsWithKeyword(token, "stop_");
+    case 'g': case 'G':
+        return startsWithKeyword(token, "global_");
+    default:
+        return false;
+    }
+}
+
+// Splits CIF text into whitespace-separated tokens without copying. Quoted
+// strings and ;-delimited text fields are returned without their
+// delimiters; comments are skipped.
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view text) : text_(text) {}
+
+    // Returns false at the end of the text. quoted is set for quoted
+    // strings and text fields, which are never tags or reserved words.
+    bool next(std::string_view& token, bool& quoted) {
+        const size_t n = text_.size();
+        while (pos_ < n) {
+            char c = text_[pos_];
+            if (isSpace(c)) {
+                ++pos_;
+                continue;
+            }
+            if (c == '#') {
+                size_t end = text_.find('\n', pos_);
+                pos_ = (end == std::string_view::npos) ? n : end + 1;
+                continue;
+            }
+            if (c == ';' && (pos_ == 0 || text_[pos_ - 1] == '\n')) {
+                // Text field: runs to the next line that starts with ';'
+                size_t start = pos_ + 1;
+                size_t end = text_.find("\n;", start);
+                if (end == std::string_view::npos) {
+                    end = n;
+                }
+                token = text_.substr(start, end - start);
+                if (!token.empty() && token.back() == '\r') {
+                    token.remove_suffix(1);
+                }
+                pos_ = std::min(end + 2, n);
+                quoted = true;
+                return true;
+            }
+            if (c == '\'' || c == '"') {
+                // Ends at a matching quote followed by whitespace, so values
+                // like 'O5'' keep their inner quote
+                size_t start = pos_ + 1;
+                size_t end = start;
+                while (end < n && text_[end] != '\n' &&
+                       !(text_[end] == c && (end + 1 == n || isSpace(text_[end + 1])))) {
+                    ++end;
+                }
+                token = text_.substr(start, end - start);
+                pos_ = (end < n && text_[end] == c) ? end + 1 : end;
+                quoted = true;
+                return true;
+            }
+            size_t start = pos_;
+            while (pos_ < n && !isSpace(text_[pos_])) {
+                ++pos_;
+            }
+            token = text_.substr(start, pos_ - start);
+            quoted = false;
+            return true;
+        }
+        return false;
+    }
+
+    size_t position() const { return pos_; }
+    void seek(size_t pos) { pos_ = pos; }
+
+private:
+    std::string_view text_;
+    size_t pos_{0};
+};
+
+// '.' (inapplicable) and '?' (unknown) read as empty values
+inline std::string_view nonNull(std::string_view value) {
+    if (value.size() == 1 && (value[0] == '.' || value[0] == '?')) {
+        return {};
+    }
+    return value;
+}
+
+// "_category.item" -> ("_category", "item")
+std::pair<std::string_view, std::string_view> splitTag(std::string_view tag) {
+    size_t dot = tag.find('.');
+    if (dot == std::string_view::npos) {
+        return {tag, std::string_view()};
+    }
+    return {tag.substr(0, dot), tag.substr(dot + 1)};
+}
+
+int columnOf(const std::vector<std::string_view>& items, std::string_view name,
+             std::string_view fallback = {}) {
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return fallback.empty() ? -1 : columnOf(items, fallback);
+}
+
+// Column indices of the _atom_site items read into Atom; -1 if absent.
+// Author identifiers win over label ones, matching what PDB files contain.
+struct AtomSiteColumns {
+    explicit AtomSiteColumns(const std::vector<std::string_view>& items)
+        : count(items.size()),
+          group(columnOf(items, "group_PDB")),
+          serial(columnOf(items, "id")),
+          name(columnOf(items, "auth_atom_id", "label_atom_id")),
+          altLoc(columnOf(items, "label_alt_id")),
+          resName(columnOf(items, "auth_comp_id", "label_comp_id")),
+          chainID(columnOf(items, "auth_asym_id", "label_asym_id")),
+          resSeq(columnOf(items, "auth_seq_id", "label_seq_id")),
+          iCode(columnOf(items, "pdbx_PDB_ins_code")),
+          x(columnOf(items, "Cartn_x")),
+          y(columnOf(items, "Cartn_y")),
+          z(columnOf(items, "Cartn_z")),
+          occupancy(columnOf(items, "occupancy")),
+          tempFactor(columnOf(items, "B_iso_or_equiv")),
+          element(columnOf(items, "type_symbol")),
+          charge(columnOf(items, "pdbx_formal_charge")),
+          model(columnOf(items, "pdbx_PDB_model_num")) {}
+
+    std::string_view get(const std::string_view* row, int column) const {
+        return column < 0 ? std::string_view() : nonNull(row[column]);
+    }
+
+    size_t count;
+    int group, serial, name, altLoc, resName, chainID, resSeq, iCode;
+    int x, y, z, occupancy, tempFactor, element, charge, model;
+};
+
+int modelNumber(const std::string_view* row, const AtomSiteColumns& columns) {
+    return columns.model < 0 ? 1 : CifModelBuilder::toInt(columns.get(row, columns.model), 1);
+}
+
+void parseAtomSite(const std::string_view* row, const AtomSiteColumns& columns,
+                   const ReaderOptions& options, int onlyModel,
+                   CifModelBuilder& builder) {
+    int number = modelNumber(row, columns);
+    if (onlyModel != CifModelBuilder::kAllModels && number != onlyModel) {
+        return;
+    }
+    Reader::Records& records = builder.records(number);
+    records.foundData = true;
+
+    // Filter on identifiers before decoding coordinates
+    bool het = columns.get(row, columns.group) == "HETATM";
+    std::string_view name = columns.get(row, columns.name);
+    std::string_view altLoc = columns.get(row, columns.altLoc);
+    std::string_view resName = columns.get(row, columns.resName);
+    std::string_view chainID = columns.get(row, columns.chainID);
+    std::string_view iCode = columns.get(row, columns.iCode);
+    std::string_view element = columns.get(row, columns.element);
+    if (!builder.checkIdentifiers(name, altLoc, resName, chainID, iCode, element) ||
+        !options.acceptAtom(name, resName, het)) {
+        return;
+    }
+
+    auto atom = records.arena.make<Atom>();
+    atom->serial = CifModelBuilder::toInt(columns.get(row, columns.serial));
+    atom->name = name;
+    atom->altLoc = altLoc;
+    atom->resName = resName;
+    atom->chainID = chainID;
+    atom->resSeq = CifModelBuilder::toInt(columns.get(row, columns.resSeq));
+    atom->iCode = iCode;
+    atom->x = CifModelBuilder::toFloat(columns.get(row, columns.x));
+    atom->y = CifModelBuilder::toFloat(columns.get(row, columns.y));
+    atom->z = CifModelBuilder::toFloat(columns.get(row, columns.z));
+    atom->occupancy = CifModelBuilder::toFloat(columns.get(row, columns.occupancy));
+    atom->tempFactor = CifModelBuilder::toFloat(columns.get(row, columns.tempFactor));
+    atom->element = element;
+    atom->charge = CifModelBuilder::formalCharge(CifModelBuilder::toInt(columns.get(row, columns.charge)));
+    (het ? records.hetAtoms : records.atoms).push_back(atom);
+}
+
+template <typename T>
+std::vector<std::unique_ptr<T>> copyAll(const std::vector<std::unique_ptr<T>>& from) {
+    std::vector<std::unique_ptr<T>> to;
+    to.reserve(from.size());
+    for (const auto& item : from) {
+        to.push_back(std::make_unique<T>(*item));
+    }
+    return to;
+}
+
+// Parses one data block into a CifModelBuilder
+class CifParser {
+public:
+    CifParser(std::string_view text, const ReaderOptions& options, bool firstModelOnly)
+        : text_(text), options_(options), firstModelOnly_(firstModelOnly) {}
+
+    void parse();
+    std::vector<std::unique_ptr<Model>> build();
+    std::string warning() const { return builder_.warning(); }
+
+private:
+    void parseLoop(Tokenizer& tokens);
+    void parseAtomSiteLoop(const std::vector<std::string_view>& items, Tokenizer& tokens);
+    bool parseAtomSiteLines(const AtomSiteColumns& columns, int onlyModel,
+                            size_t begin, size_t& end);
+    void parseRow(std::string_view category, const std::vector<std::string_view>& items,
+                  const std::string_view* row);
+
+    std::string_view text_;
+    ReaderOptions options_;
+    bool firstModelOnly_;
+    CifModelBuilder builder_;
+};
+
+void CifParser::parse() {
+    Tokenizer tokens(text_);
+    std::string_view token;
+    bool quoted = false;
+    bool inBlock = false;
+
+    // Consecutive "_category.item value" pairs form a one-row table
+    std::string_view pairCategory;
+    std::vector<std::string_view> pairItems;
+    std::vector<std::string_view> pairValues;
+    auto flushPairs = [&]() {
+        if (!pairItems.empty()) {
+            parseRow(pairCategory, pairItems, pairValues.data());
+            pairItems.clear();
+            pairValues.clear();
+        }
+    };
+
+    while (tokens.next(token, quoted)) {
+        if (quoted) {
+            continue; // Stray value
+        }
+        if (token[0] == '_') {
+            auto [category, item] = splitTag(token);
+            std::string_view value;
+            if (!tokens.next(value, quoted)) {
+                break;
+            }
+            if (category != pairCategory) {
+                flushPairs();
+                pairCategory = category;
+            }
+            pairItems.push_back(item);
+            pairValues.push_back(value);
+            continue;
+        }
+
+        flushPairs();
+        if (startsWithKeyword(token, "data_")) {
+            if (inBlock) {
+                break; // Only the first data block is read
+            }
+            inBlock = true;
+        } else if (startsWithKeyword(token, "loop_")) {
+            parseLoop(tokens);
+        }
+    }
+    flushPairs();
+}
+
+void CifParser::parseLoop(Tokenizer& tokens) {
+    std::string_view token;
+    bool quoted = false;
+
+    // Header: one tag per column, all in the same category
+    std::string_view category;
+    std::vector<std::string_view> items;
+    size_t mark = tokens.position();
+    while (tokens.next(token, quoted) && !quoted && token[0] == '_') {
+        auto [tagCategory, item] = splitTag(token);
+        category = tagCategory;
+        items.push_back(item);
+        mark = tokens.position();
+    }
+    tokens.seek(mark);
+    if (items.empty()) {
+        return;
+    }
+    if (category == "_atom_site") {
+        parseAtomSiteLoop(items, tokens);
+        return;
+    }
+
+    // Body: values fill rows column by column until the next tag or keyword
+    bool wanted = CifModelBuilder::readsCategory(category);
+    std::vector<std::string_view> row(items.size());
+    size_t column = 0;
+    while (true) {
+        mark = tokens.position();
+        if (!tokens.next(token, quoted)) {
+            break;
+        }
+        if (!quoted && isTagOrReserved(token)) {
+            tokens.seek(mark);
+            break;
+        }
+        if (!wanted) {
+            continue;
+        }
+        row[column++] = token;
+        if (column == items.size()) {
+            parseRow(category, items, row.data());
+            column = 0;
+        }
+    }
+}
+
+void CifParser::parseAtomSiteLoop(const std::vector<std::string_view>& items, Tokenizer& tokens) {
+    AtomSiteColumns columns(items);
+    std::vector<std::string_view> row(columns.count);
+    std::string_view token;
+    bool quoted = false;
+    size_t begin = tokens.position();
+
+    // read() keeps the model of the first row only
+    int onlyModel = CifModelBuilder::kAllModels;
+    if (firstModelOnly_) {
+        Tokenizer peek = tokens;
+        size_t column = 0;
+        while (column < columns.count && peek.next(token, quoted) &&
+               (quoted || !isTagOrReserved(token))) {
+            row[column++] = token;
+        }
+        if (column == columns.count) {
+            onlyModel = modelNumber(row.data(), columns);
+        }
+    }
+
+    size_t end = begin;
+    if (parseAtomSiteLines(columns, onlyModel, begin, end)) {
+        tokens.seek(end);
+        return;
+    }
+
+    // Rows span lines or contain text fields: tokenize the body serially
+    size_t column = 0;
+    while (true) {
+        size_t mark = tokens.position();
+        if (!tokens.next(token, quoted)) {
+            break;
+        }
+        if (!quoted && isTagOrReserved(token)) {
+            tokens.seek(mark);
+            break;
+        }
+        row[column++] = token;
+        if (column == columns.count) {
+            parseAtomSite(row.data(), columns, options_, onlyModel, builder_);
+            column = 0;
+        }
+    }
+}
+
+bool CifParser::parseAtomSiteLines(const AtomSiteColumns& columns, int onlyModel,
+                                   size_t begin, size_t& end) {
+    // Find the end of the loop body: the first line that starts with a tag
+    // or keyword. Text fields rule out line-based parsing.
+    const size_t n = text_.size();
+    end = begin;
+    while (end < n) {
+        size_t lineEnd = text_.find('\n', end);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = n;
+        }
+        size_t first = end;
+        while (first < lineEnd && isSpace(text_[first])) {
+            ++first;
+        }
+        if (first < lineEnd) {
+            if (text_[first] == ';') {
+                return false;
+            }
+            if (isTagOrReserved(text_.substr(first, lineEnd - first))) {
+                break;
+            }
+        }
+        end = std::min(lineEnd + 1, n);
+    }
+    std::string_view body = text_.substr(begin, end - begin);
+
+    // Cut the body at line boundaries
+    size_t chunks = parallel_thread_count(body.size() / kMinChunkBytes, options_.maxThreads);
+    std::vector<std::string_view> pieces;
+    size_t start = 0;
+    for (size_t i = 1; i <= chunks && start < body.size(); ++i) {
+        size_t pieceEnd = body.size();
+        if (i < chunks) {
+            pieceEnd = body.find('\n', std::max(start, body.size() * i / chunks));
+            pieceEnd = (pieceEnd == std::string_view::npos) ? body.size() : pieceEnd + 1;
+        }
+        pieces.push_back(body.substr(start, pieceEnd - start));
+        start = pieceEnd;
+    }
+
+    // Every non-empty line must hold exactly one row; otherwise give up and
+    // let the serial tokenizer handle the loop
+    std::vector<CifModelBuilder> parts(pieces.size());
+    std::vector<char> valid(pieces.size(), 1);
+    parallel_for(pieces.size(), [&](size_t i) {
+        std::string_view piece = pieces[i];
+        std::vector<std::string_view> row(columns.count);
+        std::string_view token;
+        bool quoted = false;
+        size_t pos = 0;
+        while (pos < piece.size()) {
+            size_t lineEnd = piece.find('\n', pos);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = piece.size();
+            }
+            Tokenizer tokens(piece.substr(pos, lineEnd - pos));
+            pos = lineEnd + 1;
+
+            size_t column = 0;
+            while (tokens.next(token, quoted)) {
+                if ((!quoted && isTagOrReserved(token)) || column == columns.count) {
+                    valid[i] = 0;
+                    return;
+                }
+                row[column++] = token;
+            }
+            if (column == 0) {
+                continue;
+            }
+            if (column != columns.count) {
+                valid[i] = 0;
+                return;
+            }
+            parseAtomSite(row.data(), columns, options_, onlyModel, parts[i]);
+        }
+    }, options_.maxThreads);
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+        return false;
+    }
+
+    // Merge in file order
+    for (auto& part : parts) {
+        builder_.append(std::move(part));
+    }
+    return true;
+}
+
+void CifParser::parseRow(std::string_view category, const std::vector<std::string_view>& items,
+                         const std::string_view* row) {
+    builder_.addRow(category, [&](std::string_view item) {
+        int column = columnOf(items, item);
+        return column < 0 ? std::string_view() : nonNull(row[column]);
+    });
+}
+
+std::vector<std::unique_ptr<Model>> CifParser::build() {
+    return builder_.build(firstModelOnly_, options_);
+}
+
+} // namespace
+
+Reader::Records& CifModelBuilder::records(int number) {
+    if (!models_.empty() && models_.back().number == number) {
+        return models_.back().records;
+    }
+    auto it = std::find_if(models_.begin(), models_.end(),
+        [number](const ModelRecords& model) { return model.number == number; });
+    if (it != models_.end()) {
+        return it->records;
+    }
+    models_.push_back(ModelRecords{number, {}});
+    return models_.back().records;
+}
+
+void CifModelBuilder::append(CifModelBuilder&& other) {
+    for (auto& model : other.models_) {
+        records(model.number).append(std::move(model.records));
+    }
+    shared_.append(std::move(other.shared_));
+    sheetStrands_.insert(other.sheetStrands_.begin(), other.sheetStrands_.end());
+    strandSense_.insert(other.strandSense_.begin(), other.strandSense_.end());
+    if (firstSkipped_.empty()) {
+        firstSkipped_ = std::move(other.firstSkipped_);
+    }
+    skippedRows_ += other.skippedRows_;
+}
+
+bool CifModelBuilder::checkIdentifiers(std::string_view name, std::string_view altLoc,
+                                       std::string_view resName, std::string_view chainID,
+                                       std::string_view iCode, std::string_view element) {
+    const std::pair<const char*, std::string_view> identifiers[] = {
+        {"atom_id", name}, {"alt_id", altLoc}, {"comp_id", resName},
+        {"asym_id", chainID}, {"ins_code", iCode}, {"type_symbol", element}
+    };
+    for (const auto& [item, value] : identifiers) {
+        if (!Code::fits(value)) {
+            if (firstSkipped_.empty()) {
+                firstSkipped_ = std::string(item) + " '" + std::string(value) + "'";
+            }
+            ++skippedRows_;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string CifModelBuilder::warning() const {
+    if (skippedRows_ == 0) {
+        return {};
+    }
+    return "skipped _atom_site rows with identifiers longer than " + std::to_string(Code::kMaxSize) +
+           " characters: " + std::to_string(skippedRows_) + ", the first with " + firstSkipped_;
+}
+
+int CifModelBuilder::toInt(std::string_view value, int fallback) {
+    int out = fallback;
+    decodeInt(value, out);
+    return out;
+}
+
+double CifModelBuilder::toFloat(std::string_view value) {
+    if (!value.empty() && value.back() == ')') {
+        value = value.substr(0, value.find('('));
+    }
+    double out = 0.0;
+    decodeFloat(value, out);
+    return out;
+}
+
+Code CifModelBuilder::formalCharge(int charge) {
+    if (charge == 0) {
+        return Code();
+    }
+    char text[2] = {static_cast<char>('0' + std::min(std::abs(charge), 9)),
+                    charge > 0 ? '+' : '-'};
+    return Code(std::string_view(text, 2));
+}
+
+bool CifModelBuilder::readsCategory(std::string_view category) {
+    return category == "_struct_conf" || category == "_struct_sheet_range" ||
+           category == "_struct_sheet" || category == "_struct_sheet_order" ||
+           category == "_pdbx_struct_oper_list";
+}
+
+void CifModelBuilder::addRow(std::string_view category, const ItemGetter& get) {
+    // Author identifiers, falling back to label ones
+    auto either = [&](std::string_view item, std::string_view fallback) {
+        std::string_view value = get(item);
+        return value.empty() ? get(fallback) : value;
+    };
+
+    if (category == "_struct_conf") {
+        if (get("conf_type_id").substr(0, 4) != "HELX") {
+            return; // Turns and other conformations
+        }
+        auto helix = std::make_unique<Helix>();
+        helix->serial = static_cast<int>(shared_.helixes.size()) + 1;
+        helix->helixID = either("pdbx_PDB_helix_id", "id");
+        helix->initResName = either("beg_auth_comp_id", "beg_label_comp_id");
+        helix->initChainID = either("beg_auth_asym_id", "beg_label_asym_id");
+        helix->initSeqNum = toInt(either("beg_auth_seq_id", "beg_label_seq_id"));
+        helix->initICode = get("pdbx_beg_PDB_ins_code");
+        helix->endResName = either("end_auth_comp_id", "end_label_comp_id");
+        helix->endChainID = either("end_auth_asym_id", "end_label_asym_id");
+        helix->endSeqNum = toInt(either("end_auth_seq_id", "end_label_seq_id"));
+        helix->endICode = get("pdbx_end_PDB_ins_code");
+        helix->helixClass = toInt(get("pdbx_PDB_helix_class"));
+        helix->length = toInt(get("pdbx_PDB_helix_length"));
+        shared_.helixes.push_back(std::move(helix));
+        shared_.foundData = true;
+    }
+    else if (category == "_struct_sheet_range") {
+        auto strand = std::make_unique<Strand>();
+        strand->strand = toInt(get("id"));
+        strand->sheetID = get("sheet_id");
+        strand->initResName = either("beg_auth_comp_id", "beg_label_comp_id");
+        strand->initChainID = either("beg_auth_asym_id", "beg_label_asym_id");
+        strand->initSeqNum = toInt(either("beg_auth_seq_id", "beg_label_seq_id"));
+        strand->initICode = get("pdbx_beg_PDB_ins_code");
+        strand->endResName = either("end_auth_comp_id", "end_label_comp_id");
+        strand->endChainID = either("end_auth_asym_id", "end_label_asym_id");
+        strand->endSeqNum = toInt(either("end_auth_seq_id", "end_label_seq_id"));
+        strand->endICode = get("pdbx_end_PDB_ins_code");
+        shared_.strands.push_back(std::move(strand));
+        shared_.foundData = true;
+    }
+    else if (category == "_struct_sheet") {
+        sheetStrands_[get("id")] = toInt(get("number_strands"));
+    }
+    else if (category == "_struct_sheet_order") {
+        // Sense of a strand relative to the one before it, as in SHEET
+        std::string_view sense = get("sense");
+        strandSense_[{Code(get("sheet_id")), Code(get("range_id_2"))}] =
+            sense == "parallel" ? 1 : (sense == "anti-parallel" ? -1 : 0);
+    }
+    else if (category == "_pdbx_struct_oper_list") {
+        static const char* const kItems[3][4] = {
+            {"matrix[1][1]", "matrix[1][2]", "matrix[1][3]", "vector[1]"},
+            {"matrix[2][1]", "matrix[2][2]", "matrix[2][3]", "vector[2]"},
+            {"matrix[3][1]", "matrix[3][2]", "matrix[3][3]", "vector[3]"},
+        };
+        for (int r = 0; r < 3; ++r) {
+            Reader::MatrixRow matrixRow;
+            matrixRow.row = r;
+            for (int c = 0; c < 4; ++c) {
+                matrixRow.values[c] = toFloat(get(kItems[r][c]));
+            }
+            shared_.matrixRows.push_back(matrixRow);
+        }
+    }
+}
+
+std::vector<std::unique_ptr<Model>> CifModelBuilder::build(bool firstModelOnly,
+                                                           const ReaderOptions& options) {
+    // Sheet categories may follow _struct_sheet_range, so fill these in last
+    for (auto& strand : shared_.strands) {
+        auto count = sheetStrands_.find(strand->sheetID);
+        if (count != sheetStrands_.end()) {
+            strand->numStrands = count->second;
+        }
+        auto sense = strandSense_.find({strand->sheetID, Code(std::to_string(strand->strand))});
+        if (sense != strandSense_.end()) {
+            strand->sense = sense->second;
+        }
+    }
+
+    // Secondary structure without coordinates still makes a model, as in
+    // PDB files
+    if (models_.empty() && shared_.foundData) {
+        models_.push_back(ModelRecords{1, {}});
+    }
+
+    std::vector<std::unique_ptr<Model>> models;
+    for (auto& entry : models_) {
+        Reader::Records& records = entry.records;
+        records.helixes = copyAll(shared_.helixes);
+        records.strands = copyAll(shared_.strands);
+        records.matrixRows = shared_.matrixRows;
+        records.foundData = records.foundData || shared_.foundData;
+        auto model = Reader::buildModel(std::move(records), options);
+        if (model) {
+            models.push_back(std::move(model));
+        }
+        if (firstModelOnly && !models.empty()) {
+            break;
+        }
+    }
+    return models;
+}
+
+std::vector<std::unique_ptr<Model>> CifReader::readAll() {
+    return parse(false);
+}
+
+std::unique_ptr<Model> CifReader::read() {
+    auto models = parse(true);
+    return models.empty() ? nullptr : std::move(models.front());
+}
+
+std::vector<std::unique_ptr<Model>> CifReader::parse(bool firstModelOnly) {
+    CifParser parser(buffer_, options_, firstModelOnly);
+    parser.parse();
+    auto models = parser.build();
+    warning_ = parser.warning();
+    return models;
+}
+
+bool isCif(std::string_view buffer) {
+    Tokenizer tokens(buffer);
+    std::string_view token;
+    bool quoted = false;
+    return tokens.next(token, quoted) && !quoted && startsWithKeyword(token, "data_");
+}
+
+} // namespace pdb
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+#include <climits>
+
+namespace pdb {
+
+// Model assembly shared by the text and binary mmCIF readers. Atom records
+// are collected per pdbx_PDB_model_num; secondary structure and assembly
+// operators are read from their own categories and attached to every model.
+class CifModelBuilder {
+public:
+    // Value of an item in the current row; empty if absent, '.' or '?'
+    using ItemGetter = std::function<std::string_view(std::string_view item)>;
+    
+    // Records of a model, created on first use; models keep first-seen order
+    Reader::Records& records(int number);
+    // Moves other's records onto the end of the matching models here
+    void append(CifModelBuilder&& other);
+    
+    // _struct_conf, _struct_sheet_range, _struct_sheet, _struct_sheet_order
+    // and _pdbx_struct_oper_list rows
+    static bool readsCategory(std::string_view category);
+    void addRow(std::string_view category, const ItemGetter& get);
+    
+    // False if an _atom_site identifier is longer than a Code holds, e.g. a
+    // five-character CCD ligand ID. Callers skip such rows instead of
+    // truncating them, since truncated chain or residue IDs would merge
+    // distinct chains; the rest of the model is kept.
+    bool checkIdentifiers(std::string_view name, std::string_view altLoc,
+                          std::string_view resName, std::string_view chainID,
+                          std::string_view iCode, std::string_view element);
+    // Rows failing checkIdentifiers, and a description of them (empty if
+    // none)
+    size_t skippedRows() const { return skippedRows_; }
+    std::string warning() const;
+    
+    std::vector<std::unique_ptr<Model>> build(bool firstModelOnly, const ReaderOptions& options);
+    
+    // PDB-style charge ("2+", "1-") for an mmCIF pdbx_formal_charge value
+    static Code formalCharge(int charge);
+    
+    // Item values as numbers; fallback (or 0.0) if empty or malformed. A
+    // standard uncertainty suffix, e.g. 12.345(6), is dropped.
+    static int toInt(std::string_view value, int fallback = 0);
+    static double toFloat(std::string_view value);
+    
+    // Model number meaning "keep every model"
+    static constexpr int kAllModels = INT_MIN;
+    
+private:
+    struct ModelRecords {
+        int number{0};
+        Reader::Records records;
+    };
+    
+    std::vector<ModelRecords> models_;
+    Reader::Records shared_;
+    std::map<Code, int> sheetStrands_;
+    std::map<std::pair<Code, Code>, int> strandSense_;
+    size_t skippedRows_{0};
+    std::string firstSkipped_;
+};
+
+// Reader for PDBx/mmCIF files, for entries too large for the PDB format.
+// Builds the same Model as Reader: atoms from the _atom_site loop (one Model
+// per pdbx_PDB_model_num), helices from _struct_conf, strands from
+// _struct_sheet_range and assembly operators from _pdbx_struct_oper_list.
+// Author (auth_*) identifiers are used where present, as in PDB files. Only
+// the first data block is read.
+class CifReader {
+public:
+    // Parses buffer in place; the buffer must outlive the CifReader
+    explicit CifReader(std::string_view buffer, const ReaderOptions& options = {})
+        : options_(options), buffer_(buffer) {}
+
+    // Reading methods
+    // Rows of large _atom_site loops are parsed in parallel line-aligned
+    // chunks; results match the serial tokenizer
+    std::vector<std::unique_ptr<Model>> readAll();
+    std::unique_ptr<Model> read();  // First model only
+    
+    // _atom_site rows the last read skipped for over-long identifiers
+    // (see CifModelBuilder::checkIdentifiers); empty if none
+    const std::string& warning() const { return warning_; }
+
+private:
+    std::vector<std::unique_ptr<Model>> parse(bool firstModelOnly);
+
+    ReaderOptions options_;
+    std::string_view buffer_;
+    std::string warning_;
+};
+
+// True if the buffer starts (after comments and blank lines) with a data_ block
+bool isCif(std::string_view buffer);
+
+} // namespace pdb
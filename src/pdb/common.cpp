@@ -1,46 +1,251 @@
 #include "pdb/common.hpp"
 #include <algorithm>
 #include <cctype>
-#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <ostream>
 
 namespace pdb {
 
-std::string parseString(const std::string& str) {
-    // Trim whitespace from both ends
-    std::string result = str;
-    result.erase(result.begin(), 
-                 std::find_if(result.begin(), result.end(), 
-                             [](unsigned char ch) { return !std::isspace(ch); }));
-    result.erase(std::find_if(result.rbegin(), result.rend(), 
-                             [](unsigned char ch) { return !std::isspace(ch); }).base(),
-                 result.end());
+std::string_view trim(std::string_view str) {
+    // Trim whitespace from both ends without copying
+    size_t begin = 0;
+    size_t end = str.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(str[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(str[end - 1]))) {
+        --end;
+    }
+    return str.substr(begin, end - begin);
+}
+
+std::string parseString(std::string_view str) {
+    return std::string(trim(str));
+}
+
+Code parseCode(std::string_view str) {
+    return Code(trim(str));
+}
+
+std::string Code::str() const {
+    std::string result;
+    for (size_t i = 0; i < size(); ++i) {
+        result += (*this)[i];
+    }
     return result;
 }
 
-int parseInt(const std::string& str) {
-    std::string trimmed = parseString(str);
-    if (trimmed.empty()) {
-        return 0;
+std::ostream& operator<<(std::ostream& out, Code code) {
+    return out << code.str();
+}
+
+int parseInt(std::string_view str) {
+    int value = 0;
+    return decodeInt(str, value) == ParseStatus::Ok ? value : 0; // Follow Go behavior of returning 0 on parse error
+}
+
+int parseHybrid36(std::string_view str, int width) {
+    int value = 0;
+    return decodeHybrid36(str, width, value) == ParseStatus::Ok ? value : 0;
+}
+
+double parseFloat(std::string_view str) {
+    double value = 0.0;
+    return decodeFloat(str, value) == ParseStatus::Ok ? value : 0.0; // Follow Go behavior of returning 0 on parse error
+}
+
+ParseStatus decodeInt(std::string_view field, int& out) {
+    std::string_view digits = trim(field);
+    if (digits.empty()) {
+        return ParseStatus::Empty;
+    }
+    
+    bool negative = digits[0] == '-';
+    if (negative || digits[0] == '+') {
+        digits.remove_prefix(1);
+    }
+    if (digits.empty()) {
+        return ParseStatus::Invalid;
     }
     
-    try {
-        return std::stoi(trimmed);
-    } catch (const std::exception&) {
-        return 0; // Follow Go behavior of returning 0 on parse error
+    int64_t value = 0;
+    for (char ch : digits) {
+        unsigned d = static_cast<unsigned char>(ch) - '0';
+        if (d > 9) {
+            return ParseStatus::Invalid;
+        }
+        value = value * 10 + d;
+        if (value > int64_t(std::numeric_limits<int>::max()) + 1) {
+            return ParseStatus::Overflow;
+        }
     }
+    if (negative) {
+        value = -value;
+    }
+    if (value > std::numeric_limits<int>::max()) {
+        return ParseStatus::Overflow;
+    }
+    
+    out = static_cast<int>(value);
+    return ParseStatus::Ok;
 }
 
-double parseFloat(const std::string& str) {
-    std::string trimmed = parseString(str);
-    if (trimmed.empty()) {
-        return 0.0;
+ParseStatus decodeHybrid36(std::string_view field, int width, int& out) {
+    std::string_view digits = trim(field);
+    if (digits.empty()) {
+        return ParseStatus::Empty;
+    }
+    bool upper = digits[0] >= 'A' && digits[0] <= 'Z';
+    bool lower = digits[0] >= 'a' && digits[0] <= 'z';
+    if (!upper && !lower) {
+        return decodeInt(digits, out);
+    }
+    if (width < 1 || width > 6 || digits.size() != size_t(width)) {
+        return ParseStatus::Invalid;
     }
     
-    try {
-        return std::stod(trimmed);
-    } catch (const std::exception&) {
-        return 0.0; // Follow Go behavior of returning 0 on parse error
+    // Base 36 over 0-9 and one letter case
+    int64_t value = 0;
+    for (char ch : digits) {
+        int d;
+        if (ch >= '0' && ch <= '9') {
+            d = ch - '0';
+        } else if (upper && ch >= 'A' && ch <= 'Z') {
+            d = ch - 'A' + 10;
+        } else if (lower && ch >= 'a' && ch <= 'z') {
+            d = ch - 'a' + 10;
+        } else {
+            return ParseStatus::Invalid;
+        }
+        value = value * 36 + d;
+    }
+    
+    // Leading letters start at 10 * 36^(width - 1); upper case continues
+    // from 10^width and lower case after all upper-case values
+    int64_t power = 1;
+    int64_t decimal = 1;
+    for (int i = 0; i < width; ++i) {
+        decimal *= 10;
+        if (i > 0) {
+            power *= 36;
+        }
+    }
+    value += decimal - 10 * power + (lower ? 26 * power : 0);
+    if (value > std::numeric_limits<int>::max()) {
+        return ParseStatus::Overflow;
+    }
+    out = static_cast<int>(value);
+    return ParseStatus::Ok;
+}
+
+ParseStatus decodeFloat(std::string_view field, double& out) {
+    // Exact powers of ten; dividing an exact mantissa by one of these is a
+    // single correctly rounded operation, so the fast path matches strtod
+    static constexpr double kPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15
+    };
+    
+    std::string_view digits = trim(field);
+    if (digits.empty()) {
+        return ParseStatus::Empty;
+    }
+    
+    bool negative = digits[0] == '-';
+    if (negative || digits[0] == '+') {
+        digits.remove_prefix(1);
+    }
+    
+    // Fast path: the fixed "%8.3f" style layout, read as one integer mantissa
+    uint64_t mantissa = 0;
+    int count = 0;
+    int fraction = -1;
+    size_t i = 0;
+    for (; i < digits.size(); ++i) {
+        unsigned d = static_cast<unsigned char>(digits[i]) - '0';
+        if (d <= 9) {
+            mantissa = mantissa * 10 + d;
+            ++count;
+            if (fraction >= 0) {
+                ++fraction;
+            }
+        } else if (digits[i] == '.' && fraction < 0) {
+            fraction = 0;
+        } else {
+            break;
+        }
+    }
+    if (i == digits.size() && count > 0 && count <= 15) {
+        double value = static_cast<double>(mantissa);
+        if (fraction > 0) {
+            value /= kPow10[fraction];
+        }
+        out = negative ? -value : value;
+        return ParseStatus::Ok;
+    }
+    
+    // Slow path: exponents and very long mantissas
+    if (digits.empty() || digits[0] == '+' || digits[0] == '-') {
+        return ParseStatus::Invalid;
+    }
+    double value = 0.0;
+    auto result = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        return ParseStatus::Overflow;
+    }
+    if (result.ec != std::errc() || result.ptr != digits.data() + digits.size()) {
+        return ParseStatus::Invalid;
+    }
+    out = negative ? -value : value;
+    return ParseStatus::Ok;
+}
+
+bool encodeHybrid36(int value, int width, char* out) {
+    if (width < 1 || width > 6) {
+        return false;
+    }
+    int64_t power = 1;
+    int64_t decimal = 1;
+    for (int i = 0; i < width; ++i) {
+        decimal *= 10;
+        if (i > 0) {
+            power *= 36;
+        }
+    }
+    
+    // Plain decimal, right-aligned
+    if (value < decimal && value > -decimal / 10) {
+        char digits[16];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        size_t length = size_t(end - digits);
+        if (length > size_t(width)) {
+            return false;
+        }
+        std::fill(out, out + width - length, ' ');
+        std::copy(digits, end, out + width - length);
+        return true;
+    }
+    if (value < 0) {
+        return false;
+    }
+    
+    // Upper-case leading letter, then lower-case
+    int64_t rest = value - decimal + 10 * power;
+    const char* letters = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    if (rest >= 36 * power) {
+        rest -= 26 * power;
+        letters = "0123456789abcdefghijklmnopqrstuvwxyz";
+        if (rest >= 36 * power) {
+            return false;
+        }
+    }
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = letters[rest % 36];
+        rest /= 36;
     }
+    return true;
 }
 
 Matrix identity() {
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <map>
 #include <array>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 
 namespace pdb {
 
@@ -21,6 +25,66 @@ class Reader;
 // Type aliases
 using Matrix = std::array<std::array<double, 4>, 4>;
 
+// Packed identifier code for atom names, residue names, chain IDs, elements,
+// altLocs, insertion codes and charges. Up to four characters are stored in
+// one 32-bit word (first character in the high byte), so equality, ordering
+// and hashing are single integer operations. Longer strings are truncated;
+// readers of formats without fixed columns check fits() first.
+class Code {
+public:
+    static constexpr size_t kMaxSize = 4;
+    
+    // Constructors
+    constexpr Code() = default;
+    constexpr Code(std::string_view str) : value_(pack(str)) {}
+    constexpr Code(const char* str) : Code(std::string_view(str)) {}
+    Code(const std::string& str) : Code(std::string_view(str)) {}
+    
+    static constexpr bool fits(std::string_view str) { return str.size() <= kMaxSize; }
+    
+    static constexpr Code fromValue(uint32_t value) {
+        Code code;
+        code.value_ = value;
+        return code;
+    }
+    
+    // Accessors
+    constexpr uint32_t value() const { return value_; }
+    constexpr bool empty() const { return value_ == 0; }
+    constexpr size_t size() const {
+        size_t n = 0;
+        while (n < 4 && (*this)[n] != '\0') {
+            ++n;
+        }
+        return n;
+    }
+    constexpr char operator[](size_t i) const {
+        return static_cast<char>((value_ >> (24 - 8 * i)) & 0xff);
+    }
+    std::string str() const;
+    
+    // Comparison
+    friend constexpr bool operator==(Code a, Code b) { return a.value_ == b.value_; }
+    friend constexpr bool operator!=(Code a, Code b) { return a.value_ != b.value_; }
+    friend constexpr bool operator<(Code a, Code b) { return a.value_ < b.value_; }
+    
+private:
+    static constexpr uint32_t pack(std::string_view str) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            value <<= 8;
+            if (i < str.size()) {
+                value |= static_cast<unsigned char>(str[i]);
+            }
+        }
+        return value;
+    }
+    
+    uint32_t value_{0};
+};
+
+std::ostream& operator<<(std::ostream& out, Code code);
+
 // Enums
 enum class ResidueType {
     Unknown = 0,
@@ -29,10 +93,46 @@ enum class ResidueType {
     Strand = 3
 };
 
+// Outcome of decoding a fixed-column numeric field
+enum class ParseStatus {
+    Ok = 0,
+    Empty = 1,    // Field is blank
+    Invalid = 2,  // Field is not a number
+    Overflow = 3  // Value does not fit the result type
+};
+
 // Utility functions
-std::string parseString(const std::string& str);
-int parseInt(const std::string& str);
-double parseFloat(const std::string& str);
+std::string_view trim(std::string_view str);
+std::string parseString(std::string_view str);
+Code parseCode(std::string_view str);
+int parseInt(std::string_view str);
+int parseHybrid36(std::string_view str, int width);
+double parseFloat(std::string_view str);
+
+// Non-throwing, allocation-free decoders for fixed PDB columns. On anything
+// other than ParseStatus::Ok, out is left untouched.
+ParseStatus decodeInt(std::string_view field, int& out);
+ParseStatus decodeFloat(std::string_view field, double& out);
+
+// Hybrid-36 integer field of the given width (5 for atom serials, 4 for
+// residue numbers): decimal up to 10^width - 1, then base-36 with an
+// upper-case leading letter ("A0000" = 100000), then lower-case
+ParseStatus decodeHybrid36(std::string_view field, int width, int& out);
+// Inverse of decodeHybrid36: writes value right-aligned into out[0, width)
+// and returns false, leaving out untouched, if it does not fit
+bool encodeHybrid36(int value, int width, char* out);
 Matrix identity();
 
 } // namespace pdb
+
+namespace std {
+
+template <>
+struct hash<pdb::Code> {
+    size_t operator()(pdb::Code code) const noexcept {
+        // Fibonacci hashing spreads the packed characters over all bits
+        return static_cast<size_t>(code.value() * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+} // namespace std
@@ -0,0 +1,156 @@
+#include "pdb/ensemble.hpp"
+#include "pdb/atom_table.hpp"
+#include "pdb/bcif.hpp"
+#include "pdb/cif.hpp"
+#include "utils/gzip_stream.hpp"
+#include "utils/mapped_file.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace pdb {
+
+namespace {
+
+// Calls f(atom) for every atom of model in frame order
+template <typename F>
+void forEachAtom(const Model& model, F&& f) {
+    for (const auto& atom : model.atoms) {
+        f(*atom);
+    }
+    for (const auto& atom : model.hetAtoms) {
+        f(*atom);
+    }
+}
+
+bool sameAtom(const Atom& a, const Atom& b) {
+    return a.name == b.name && a.resSeq == b.resSeq && a.chainID == b.chainID &&
+           a.resName == b.resName;
+}
+
+std::unique_ptr<Ensemble> readAllModels(std::string_view buffer, const ReaderOptions& options) {
+    if (isBinaryCif(buffer)) {
+        return Ensemble::fromModels(BinaryCifReader(buffer, options).readAll());
+    }
+    if (isCif(buffer)) {
+        return Ensemble::fromModels(CifReader(buffer, options).readAll());
+    }
+    Reader reader(buffer, options);
+    return Ensemble::read(reader);
+}
+
+} // namespace
+
+Ensemble::Ensemble(std::unique_ptr<Model> topology)
+    : topology_(std::move(topology)),
+      atomCount_(topology_->atoms.size() + topology_->hetAtoms.size()) {}
+
+std::unique_ptr<Ensemble> Ensemble::fromModels(std::vector<std::unique_ptr<Model>>&& models) {
+    if (models.empty() || !models[0]) {
+        return nullptr;
+    }
+    std::unique_ptr<Ensemble> ensemble(new Ensemble(std::move(models[0])));
+    ensemble->coordinates_.reserve(models.size() * ensemble->atomCount_ * 3);
+    ensemble->addFrame(*ensemble->topology_);
+    for (size_t i = 1; i < models.size(); ++i) {
+        if (!models[i] || !ensemble->addFrame(*models[i])) {
+            return nullptr;
+        }
+        models[i].reset();  // Free each graph once its coordinates are copied
+    }
+    models.clear();
+    return ensemble;
+}
+
+std::unique_ptr<Ensemble> Ensemble::read(Reader& reader) {
+    std::unique_ptr<Ensemble> ensemble;
+    bool failed = false;
+    reader.stream([&](std::unique_ptr<Model> model) {
+        if (!ensemble) {
+            ensemble.reset(new Ensemble(std::move(model)));
+            ensemble->addFrame(*ensemble->topology_);
+            return true;
+        }
+        failed = !ensemble->addFrame(*model);
+        return !failed;
+    });
+    return failed ? nullptr : std::move(ensemble);
+}
+
+bool Ensemble::addFrame(const Model& model) {
+    if (model.atoms.size() != topology_->atoms.size() ||
+        model.hetAtoms.size() != topology_->hetAtoms.size()) {
+        return false;
+    }
+
+    // Check identities against the topology while copying coordinates
+    size_t begin = coordinates_.size();
+    coordinates_.resize(begin + atomCount_ * 3);
+    float* out = coordinates_.data() + begin;
+    const Model& reference = *topology_;
+    size_t i = 0;
+    bool matches = true;
+    forEachAtom(model, [&](const Atom& atom) {
+        const Atom& expected = i < reference.atoms.size() ? *reference.atoms[i]
+                                                          : *reference.hetAtoms[i - reference.atoms.size()];
+        matches = matches && sameAtom(atom, expected);
+        out[3 * i] = static_cast<float>(atom.x);
+        out[3 * i + 1] = static_cast<float>(atom.y);
+        out[3 * i + 2] = static_cast<float>(atom.z);
+        ++i;
+    });
+    if (!matches) {
+        coordinates_.resize(begin);
+        return false;
+    }
+    ++frameCount_;
+    return true;
+}
+
+void Ensemble::applyFrame(size_t index) {
+    const float* in = frame(index);
+    forEachAtom(*topology_, [&in](Atom& atom) {
+        atom.x = in[0];
+        atom.y = in[1];
+        atom.z = in[2];
+        in += 3;
+    });
+    current_ = index;
+}
+
+void Ensemble::applyFrame(size_t index, AtomTable& table) const {
+    const float* in = frame(index);
+    size_t count = std::min(table.size(), atomCount_);
+    for (size_t i = 0; i < count; ++i) {
+        table.x[i] = in[3 * i];
+        table.y[i] = in[3 * i + 1];
+        table.z[i] = in[3 * i + 2];
+    }
+}
+
+std::unique_ptr<Ensemble> readEnsemble(const std::string& path, const ReaderOptions& options) {
+    MappedFile file(path);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    if (!is_gzip(file.view())) {
+        return readAllModels(file.view(), options);
+    }
+
+    // As in loadCached: PDB text is parsed while inflating, mmCIF is
+    // collected first
+    GzipStream stream(file.view());
+    std::string_view head = stream.buffer().peek_chunk();
+    std::unique_ptr<Ensemble> ensemble;
+    if (isBinaryCif(head) || isCif(head)) {
+        std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if (stream.ok()) {
+            ensemble = readAllModels(text, options);
+        }
+    } else {
+        Reader reader(stream, options);
+        ensemble = Ensemble::read(reader);
+    }
+    return stream.ok() ? std::move(ensemble) : nullptr;
+}
+
+} // namespace pdb
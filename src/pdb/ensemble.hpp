@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+
+namespace pdb {
+
+class AtomTable;
+
+// Models of an ensemble (e.g. an NMR bundle or a trajectory) that share one
+// topology. The first model is kept as the topology; every model, the first
+// included, is stored as a frame of xyz floats for its atoms followed by its
+// hetAtoms, and all frames sit back to back in one array. Switching frames
+// only rewrites coordinates.
+class Ensemble {
+public:
+    // Takes the models; returns nullptr if there are none or their atoms
+    // differ in count, name, residue or chain
+    static std::unique_ptr<Ensemble> fromModels(std::vector<std::unique_ptr<Model>>&& models);
+
+    // Streams models from reader, keeping only the first model's atoms,
+    // residues and chains; same failure cases as fromModels
+    static std::unique_ptr<Ensemble> read(Reader& reader);
+
+    Model& topology() { return *topology_; }
+    const Model& topology() const { return *topology_; }
+    size_t frameCount() const { return frameCount_; }
+    size_t atomCount() const { return atomCount_; }
+    size_t currentFrame() const { return current_; }
+
+    // atomCount() xyz triples in Model order
+    const float* frame(size_t index) const { return coordinates_.data() + index * atomCount_ * 3; }
+    float* frame(size_t index) { return coordinates_.data() + index * atomCount_ * 3; }
+
+    // Copies a frame into the topology's atoms, or into a table built from it
+    void applyFrame(size_t index);
+    void applyFrame(size_t index, AtomTable& table) const;
+
+private:
+    explicit Ensemble(std::unique_ptr<Model> topology);
+    bool addFrame(const Model& model);
+
+    std::unique_ptr<Model> topology_;
+    std::vector<float> coordinates_;
+    size_t atomCount_{0};
+    size_t frameCount_{0};
+    size_t current_{0};
+};
+
+// Reads every model of a PDB, mmCIF or BinaryCIF file, optionally
+// gzip-compressed, into an Ensemble. PDB text is streamed so only one
+// model's graph is alive at a time.
+std::unique_ptr<Ensemble> readEnsemble(const std::string& path, const ReaderOptions& options = {});
+
+} // namespace pdb
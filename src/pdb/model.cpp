@@ -1,44 +1,444 @@
 #include "pdb/model.hpp"
-#include <sstream>
+#include "pdb/selection.hpp"
+#include "utils/parallel.hpp"
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace pdb {
 
-void Model::removeChain(const std::string& chainID) {
-    // Remove atoms
-    atoms.erase(std::remove_if(atoms.begin(), atoms.end(),
-        [&chainID](const std::shared_ptr<Atom>& atom) {
-            return atom->chainID == chainID;
-        }), atoms.end());
-    
-    // Remove hetAtoms  
-    hetAtoms.erase(std::remove_if(hetAtoms.begin(), hetAtoms.end(),
-        [&chainID](const std::shared_ptr<Atom>& atom) {
-            return atom->chainID == chainID;
-        }), hetAtoms.end());
-    
-    // Remove residues
-    residues.erase(std::remove_if(residues.begin(), residues.end(),
-        [&chainID](const std::shared_ptr<Residue>& residue) {
-            return residue->chainID == chainID;
-        }), residues.end());
-    
-    // Remove chains
+namespace {
+
+// Group of each item: chain IDs numbered in order of first appearance
+template <typename T, typename GroupOf>
+std::vector<uint32_t> groupsOf(const std::vector<T>& list, GroupOf&& groupOf) {
+    std::vector<uint32_t> groups(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+        groups[i] = groupOf(list[i]->chainID);
+    }
+    return groups;
+}
+
+// Stable counting sort of list by group; begin receives the groupCount + 1
+// group offsets. Lists that are already grouped are not moved.
+template <typename T>
+void sortByGroup(std::vector<T>& list, const std::vector<uint32_t>& groups, size_t groupCount,
+                 std::vector<uint32_t>& begin) {
+    begin.assign(groupCount + 1, 0);
+    bool ordered = true;
+    for (size_t i = 0; i < list.size(); ++i) {
+        ++begin[groups[i] + 1];
+        ordered = ordered && (i == 0 || groups[i] >= groups[i - 1]);
+    }
+    for (size_t g = 0; g < groupCount; ++g) {
+        begin[g + 1] += begin[g];
+    }
+    if (ordered) {
+        return;
+    }
+    std::vector<T> sorted(list.size());
+    std::vector<uint32_t> cursor(begin.begin(), begin.end() - 1);
+    for (size_t i = 0; i < list.size(); ++i) {
+        sorted[cursor[groups[i]]++] = std::move(list[i]);
+    }
+    list.swap(sorted);
+}
+
+template <typename T>
+ListSlice<T> sliceOf(const std::vector<T>& list, uint32_t begin, uint32_t end) {
+    return ListSlice<T>{list.data() + begin, list.data() + end};
+}
+
+} // namespace
+
+void Model::removeChain(Code chainID) {
+    if (!chainRangesMatch()) {
+        indexChains();
+    }
+    auto it = std::find_if(chainRanges.begin(), chainRanges.end(),
+        [chainID](const ChainRange& range) {
+            return range.chainID == chainID;
+        });
+    if (it == chainRanges.end()) {
+        return;
+    }
+    const ChainRange removed = *it;
+    
+    // One erase per list, then shift the ranges that followed
+    auto eraseRange = [](auto& list, uint32_t begin, uint32_t end) {
+        list.erase(list.begin() + begin, list.begin() + end);
+    };
+    eraseRange(atoms, removed.atomBegin, removed.atomEnd);
+    eraseRange(hetAtoms, removed.hetAtomBegin, removed.hetAtomEnd);
+    eraseRange(residues, removed.residueBegin, removed.residueEnd);
+    eraseRange(chains, removed.chainBegin, removed.chainEnd);
+    for (auto next = chainRanges.erase(it); next != chainRanges.end(); ++next) {
+        auto shift = [](uint32_t& begin, uint32_t& end, uint32_t count) {
+            begin -= count;
+            end -= count;
+        };
+        shift(next->atomBegin, next->atomEnd, removed.atomEnd - removed.atomBegin);
+        shift(next->hetAtomBegin, next->hetAtomEnd, removed.hetAtomEnd - removed.hetAtomBegin);
+        shift(next->residueBegin, next->residueEnd, removed.residueEnd - removed.residueBegin);
+        shift(next->chainBegin, next->chainEnd, removed.chainEnd - removed.chainBegin);
+    }
+}
+
+void Model::indexChains() {
+    // Number chain IDs by first appearance; runs of one ID hit the cache
+    std::vector<Code> ids;
+    std::unordered_map<Code, uint32_t> numbers;
+    Code lastID;
+    uint32_t lastGroup = 0;
+    bool cached = false;
+    auto groupOf = [&](Code id) {
+        if (!cached || id != lastID) {
+            auto inserted = numbers.emplace(id, uint32_t(ids.size()));
+            if (inserted.second) {
+                ids.push_back(id);
+            }
+            lastID = id;
+            lastGroup = inserted.first->second;
+            cached = true;
+        }
+        return lastGroup;
+    };
+    std::vector<uint32_t> atomGroups = groupsOf(atoms, groupOf);
+    std::vector<uint32_t> hetAtomGroups = groupsOf(hetAtoms, groupOf);
+    std::vector<uint32_t> residueGroups = groupsOf(residues, groupOf);
+    std::vector<uint32_t> chainGroups = groupsOf(chains, groupOf);
+    
+    std::vector<uint32_t> atomBegin, hetAtomBegin, residueBegin, chainBegin;
+    sortByGroup(atoms, atomGroups, ids.size(), atomBegin);
+    sortByGroup(hetAtoms, hetAtomGroups, ids.size(), hetAtomBegin);
+    sortByGroup(residues, residueGroups, ids.size(), residueBegin);
+    sortByGroup(chains, chainGroups, ids.size(), chainBegin);
+    
+    chainRanges.resize(ids.size());
+    for (size_t g = 0; g < ids.size(); ++g) {
+        chainRanges[g] = ChainRange{ids[g], atomBegin[g], atomBegin[g + 1],
+                                    hetAtomBegin[g], hetAtomBegin[g + 1],
+                                    residueBegin[g], residueBegin[g + 1],
+                                    chainBegin[g], chainBegin[g + 1]};
+    }
+}
+
+bool Model::chainRangesMatch() const {
+    // Each list is covered by consecutive ranges; the end items of a range
+    // carry its ID
+    auto covers = [this](const auto& list, auto begin, auto end) {
+        uint32_t next = 0;
+        for (const ChainRange& range : chainRanges) {
+            uint32_t first = range.*begin;
+            uint32_t last = range.*end;
+            if (first != next || last < first || last > list.size()) {
+                return false;
+            }
+            if (last > first && (list[first]->chainID != range.chainID ||
+                                 list[last - 1]->chainID != range.chainID)) {
+                return false;
+            }
+            next = last;
+        }
+        return next == list.size();
+    };
+    return covers(atoms, &ChainRange::atomBegin, &ChainRange::atomEnd) &&
+           covers(hetAtoms, &ChainRange::hetAtomBegin, &ChainRange::hetAtomEnd) &&
+           covers(residues, &ChainRange::residueBegin, &ChainRange::residueEnd) &&
+           covers(chains, &ChainRange::chainBegin, &ChainRange::chainEnd);
+}
+
+const ChainRange* Model::chainRange(Code chainID) const {
+    for (const ChainRange& range : chainRanges) {
+        if (range.chainID == chainID) {
+            return &range;
+        }
+    }
+    return nullptr;
+}
+
+ChainSlice Model::chain(Code chainID) const {
+    const ChainRange* range = chainRange(chainID);
+    if (!range) {
+        return ChainSlice{chainID, {}, {}, {}, {}};
+    }
+    return ChainSlice{chainID,
+                      sliceOf(atoms, range->atomBegin, range->atomEnd),
+                      sliceOf(hetAtoms, range->hetAtomBegin, range->hetAtomEnd),
+                      sliceOf(residues, range->residueBegin, range->residueEnd),
+                      sliceOf(chains, range->chainBegin, range->chainEnd)};
+}
+
+Selection Model::chainRows(Code chainID) const {
+    Selection rows(atoms.size() + hetAtoms.size());
+    if (const ChainRange* range = chainRange(chainID)) {
+        for (uint32_t row = range->atomBegin; row < range->atomEnd; ++row) {
+            rows.set(row);
+        }
+        for (uint32_t row = range->hetAtomBegin; row < range->hetAtomEnd; ++row) {
+            rows.set(atoms.size() + row);
+        }
+    }
+    return rows;
+}
+
+void Model::removeAtoms(const Selection& rows) {
+    // Compact both atom lists, remembering what went
+    std::vector<const Atom*> removed;
+    auto sweep = [&](std::vector<Atom*>& list, size_t firstRow) {
+        size_t kept = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            size_t row = firstRow + i;
+            if (row < rows.size() && rows.test(row)) {
+                removed.push_back(list[i]);
+            } else {
+                list[kept++] = std::move(list[i]);
+            }
+        }
+        list.resize(kept);
+    };
+    size_t atomCount = atoms.size();
+    sweep(atoms, 0);
+    sweep(hetAtoms, atomCount);
+    if (removed.empty()) {
+        return;
+    }
+    std::sort(removed.begin(), removed.end());
+    
+    // Drop them from their residues, then drop emptied residues and chains
+    auto isRemoved = [&removed](const Atom* atom) {
+        return std::binary_search(removed.begin(), removed.end(), atom);
+    };
+    for (const auto& residue : residues) {
+        auto end = std::remove_if(residue->atoms.begin(), residue->atoms.end(), isRemoved);
+        if (end != residue->atoms.end()) {
+            residue->atoms.erase(end, residue->atoms.end());
+            residue->indexAtoms();
+        }
+    }
+    auto isEmpty = [](const Residue* residue) {
+        return residue->atoms.empty();
+    };
+    for (const auto& chain : chains) {
+        chain->residues.erase(std::remove_if(chain->residues.begin(), chain->residues.end(), isEmpty),
+                              chain->residues.end());
+    }
+    residues.erase(std::remove_if(residues.begin(), residues.end(), isEmpty), residues.end());
     chains.erase(std::remove_if(chains.begin(), chains.end(),
-        [&chainID](const std::shared_ptr<Chain>& chain) {
-            return chain->chainID == chainID;
+        [](const Chain* chain) {
+            return chain->residues.empty();
         }), chains.end());
+    indexChains();
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> Model::resolveConnections() const {
+    SerialIndex index(*this);
+    std::vector<std::pair<uint32_t, uint32_t>> bonds;
+    bonds.reserve(connections.size());
+    for (const auto& connection : connections) {
+        uint32_t a = index.find(connection.serial1);
+        uint32_t b = index.find(connection.serial2);
+        if (a != SerialIndex::kNoAtom && b != SerialIndex::kNoAtom) {
+            bonds.emplace_back(a, b);
+        }
+    }
+    return bonds;
+}
+
+SerialIndex::SerialIndex(const Model& model) {
+    size_t count = model.atoms.size() + model.hetAtoms.size();
+    auto serialAt = [&model](size_t row) {
+        return row < model.atoms.size() ? model.atoms[row]->serial
+                                        : model.hetAtoms[row - model.atoms.size()]->serial;
+    };
+    if (count == 0) {
+        return;
+    }
+    
+    int64_t low = serialAt(0);
+    int64_t high = low;
+    for (size_t row = 1; row < count; ++row) {
+        low = std::min<int64_t>(low, serialAt(row));
+        high = std::max<int64_t>(high, serialAt(row));
+    }
+    
+    if (high - low < int64_t(2 * count + 1024)) {
+        base_ = low;
+        direct_.assign(size_t(high - low + 1), kNoAtom);
+        for (size_t row = count; row-- > 0;) {
+            direct_[size_t(serialAt(row) - base_)] = uint32_t(row);
+        }
+        return;
+    }
+    
+    // Power-of-two capacity at most half full
+    size_t capacity = 2;
+    shift_ = 63;
+    while (capacity < 2 * count) {
+        capacity *= 2;
+        --shift_;
+    }
+    keys_.resize(capacity);
+    rows_.assign(capacity, kNoAtom);
+    for (size_t row = 0; row < count; ++row) {
+        insert(serialAt(row), uint32_t(row));
+    }
+}
+
+size_t SerialIndex::slotOf(int serial) const {
+    // Fibonacci hashing: the top bits of a multiplicative hash
+    return size_t((uint64_t(uint32_t(serial)) * 0x9E3779B97F4A7C15ull) >> shift_);
+}
+
+void SerialIndex::insert(int serial, uint32_t row) {
+    size_t mask = rows_.size() - 1;
+    size_t slot = slotOf(serial);
+    while (rows_[slot] != kNoAtom) {
+        if (keys_[slot] == serial) {
+            return;  // Keep the first atom with this serial
+        }
+        slot = (slot + 1) & mask;
+    }
+    keys_[slot] = serial;
+    rows_[slot] = row;
+}
+
+uint32_t SerialIndex::find(int serial) const {
+    if (!direct_.empty()) {
+        int64_t offset = int64_t(serial) - base_;
+        return offset >= 0 && offset < int64_t(direct_.size()) ? direct_[size_t(offset)] : kNoAtom;
+    }
+    if (rows_.empty()) {
+        return kNoAtom;
+    }
+    size_t mask = rows_.size() - 1;
+    size_t slot = slotOf(serial);
+    while (rows_[slot] != kNoAtom) {
+        if (keys_[slot] == serial) {
+            return rows_[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return kNoAtom;
+}
+
+ReaderOptions ReaderOptions::caTrace() {
+    ReaderOptions options;
+    options.atoms = AtomFilter::CAOnly;
+    options.skipHetAtoms = true;
+    options.skipWater = true;
+    options.skipConnections = true;
+    options.altLoc = kFirstAltLoc;
+    return options;
+}
+
+bool ReaderOptions::acceptAtom(std::string_view line, bool het) const {
+    if (het && skipHetAtoms) {
+        return false;
+    }
+    if (line.length() < 80) {
+        return true; // Too short to parse; left for the caller to reject
+    }
+    if (atoms == AtomFilter::All && !skipWater) {
+        return true;
+    }
+    return acceptAtom(parseCode(line.substr(12, 4)), parseCode(line.substr(17, 3)), het);
+}
+
+bool ReaderOptions::acceptAtom(Code name, Code resName, bool het) const {
+    if (het && skipHetAtoms) {
+        return false;
+    }
+    if (atoms != AtomFilter::All) {
+        bool keep = name == "CA";
+        if (atoms == AtomFilter::Backbone) {
+            keep = keep || name == "N" || name == "C" || name == "O";
+        }
+        if (!keep) {
+            return false;
+        }
+    }
+    if (skipWater && (resName == "HOH" || resName == "WAT" || resName == "DOD")) {
+        return false;
+    }
+    return true;
+}
+
+void ReaderOptions::selectAltLocs(std::vector<Atom*>& atoms) const {
+    if (altLoc == '\0') {
+        return;
+    }
+    
+    // Label kept for each atom with alternates: the requested one if any
+    // alternate has it, otherwise the first seen
+    struct AtomKey {
+        uint32_t chainID, iCode, name;
+        int resSeq;
+        bool operator==(const AtomKey& other) const {
+            return chainID == other.chainID && iCode == other.iCode &&
+                   name == other.name && resSeq == other.resSeq;
+        }
+    };
+    struct AtomKeyHash {
+        size_t operator()(const AtomKey& key) const {
+            uint64_t hash = (uint64_t(key.chainID) << 32 | key.name) * 0x9E3779B97F4A7C15ull;
+            return size_t(hash ^ (uint64_t(uint32_t(key.resSeq)) << 8 | key.iCode >> 24));
+        }
+    };
+    auto keyOf = [](const Atom& atom) {
+        return AtomKey{atom.chainID.value(), atom.iCode.value(), atom.name.value(), atom.resSeq};
+    };
+    
+    std::unordered_map<AtomKey, char, AtomKeyHash> kept;
+    for (const auto& atom : atoms) {
+        if (atom->altLoc.empty()) {
+            continue;
+        }
+        char label = atom->altLoc[0];
+        auto [it, inserted] = kept.emplace(keyOf(*atom), label);
+        if (!inserted && label == altLoc) {
+            it->second = label;
+        }
+    }
+    if (kept.empty()) {
+        return;
+    }
+    atoms.erase(std::remove_if(atoms.begin(), atoms.end(), [&](const Atom* atom) {
+        return !atom->altLoc.empty() && kept[keyOf(*atom)] != atom->altLoc[0];
+    }), atoms.end());
 }
 
 std::vector<std::unique_ptr<Model>> Reader::readAll() {
-    std::vector<std::unique_ptr<Model>> models;
+    if (stream_) {
+        // Pull the rest of the stream into memory so it can be split up
+        ownedBuffer_.assign(std::istreambuf_iterator<char>(*stream_),
+                            std::istreambuf_iterator<char>());
+        buffer_ = ownedBuffer_;
+        offset_ = 0;
+        stream_ = nullptr;
+    }
     
-    while (true) {
-        auto model = read();
+    // Find model boundaries up front, then parse the blocks concurrently.
+    // A lone model is split into chunks instead.
+    std::vector<std::string_view> blocks = splitModels();
+    std::vector<std::unique_ptr<Model>> parsed(blocks.size());
+    if (blocks.size() == 1) {
+        parsed[0] = parseBlock(blocks[0], chunkCount(blocks[0].size(), options_.maxThreads), options_);
+    } else {
+        parallel_for(blocks.size(), [&](size_t i) {
+            parsed[i] = parseBlock(blocks[i], 1, options_);
+        }, options_.maxThreads);
+    }
+    
+    std::vector<std::unique_ptr<Model>> models;
+    models.reserve(parsed.size());
+    for (auto& model : parsed) {
         if (model) {
             models.push_back(std::move(model));
-        } else {
-            break; // End of stream or error
         }
     }
     
@@ -46,126 +446,320 @@ std::vector<std::unique_ptr<Model>> Reader::readAll() {
 }
 
 std::unique_ptr<Model> Reader::read() {
-    bool foundData = false;
-    std::vector<std::shared_ptr<Atom>> atoms;
-    std::vector<std::shared_ptr<Atom>> hetAtoms;
-    std::vector<std::unique_ptr<Connection>> connections;
-    std::vector<std::unique_ptr<Helix>> helixes;
-    std::vector<std::unique_ptr<Strand>> strands;
-    std::vector<Matrix> bioMatrixes;
-    std::vector<Matrix> symMatrixes;
+    if (!stream_) {
+        std::string_view block = nextBlock();
+        return parseBlock(block, chunkCount(block.size(), options_.maxThreads), options_);
+    }
     
-    Matrix currentMatrix = identity();
-    std::string line;
+    Records records;
+    std::string_view line;
     
-    while (std::getline(stream_, line)) {
+    while (nextLine(line)) {
         // Check for model end
-        if (foundData && line.substr(0, 6) == "ENDMDL") {
+        if (records.foundData && line.substr(0, 6) == "ENDMDL") {
             break;
         }
-        
-        // Parse different record types
-        if (line.substr(0, 6) == "ATOM  ") {
-            auto atom = Atom::parseAtom(line);
-            if (atom) {
-                atoms.push_back(std::move(atom));
-                foundData = true;
+        parseRecord(line, records, options_);
+    }
+    
+    return buildModel(std::move(records), options_);
+}
+
+size_t Reader::stream(const std::function<bool(std::unique_ptr<Model>)>& consumer,
+                      size_t prefetch) {
+    prefetch = std::max<size_t>(prefetch, 1);
+    std::deque<std::unique_ptr<Model>> queue;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool done = false;
+    bool stopped = false;
+    std::exception_ptr error;
+    
+    // Producer: parse ahead until the queue is full
+    std::thread producer([&]() {
+        try {
+            while (true) {
+                auto model = read();
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!model || stopped) {
+                    break;
+                }
+                notFull.wait(lock, [&]() { return queue.size() < prefetch || stopped; });
+                if (stopped) {
+                    break;
+                }
+                queue.push_back(std::move(model));
+                notEmpty.notify_one();
             }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
         }
-        else if (line.substr(0, 6) == "HETATM") {
-            auto atom = Atom::parseAtom(line);
-            if (atom) {
-                hetAtoms.push_back(std::move(atom));
-                foundData = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        notEmpty.notify_one();
+    });
+    
+    auto stop = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        notFull.notify_one();
+    };
+    
+    // Consumer: runs on the calling thread
+    size_t delivered = 0;
+    while (true) {
+        std::unique_ptr<Model> model;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [&]() { return !queue.empty() || done; });
+            if (queue.empty()) {
+                break;
             }
+            model = std::move(queue.front());
+            queue.pop_front();
+            notFull.notify_one();
         }
-        else if (line.substr(0, 6) == "CONECT") {
-            auto conns = Connection::parseConnections(line);
-            for (auto& conn : conns) {
-                connections.push_back(std::move(conn));
-            }
+        ++delivered;
+        bool keepGoing = false;
+        try {
+            keepGoing = consumer(std::move(model));
+        } catch (...) {
+            stop();
+            producer.join();
+            throw;
+        }
+        if (!keepGoing) {
+            stop();
+            break;
+        }
+    }
+    
+    producer.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return delivered;
+}
+
+bool Reader::nextLine(std::string_view& line) {
+    if (stream_) {
+        if (!std::getline(*stream_, lineBuffer_)) {
+            return false;
+        }
+        line = lineBuffer_;
+        return true;
+    }
+    
+    // Slice the next line straight out of the buffer
+    if (offset_ >= buffer_.size()) {
+        return false;
+    }
+    size_t end = buffer_.find('\n', offset_);
+    if (end == std::string_view::npos) {
+        end = buffer_.size();
+    }
+    line = buffer_.substr(offset_, end - offset_);
+    offset_ = end + 1;
+    return true;
+}
+
+std::string_view Reader::nextBlock() {
+    // Mirrors the stream loop in read(): a block ends at the first ENDMDL
+    // that follows a record parseRecord would keep, so each block parses to
+    // exactly one model
+    size_t blockStart = std::min(offset_, buffer_.size());
+    bool foundData = false;
+    std::string_view line;
+    
+    while (nextLine(line)) {
+        if (foundData && line.substr(0, 6) == "ENDMDL") {
+            break;
+        }
+        if (!foundData && isDataRecord(line)) {
             foundData = true;
         }
-        else if (line.substr(0, 6) == "HELIX ") {
-            auto helix = Helix::parseHelix(line);
-            if (helix) {
-                helixes.push_back(std::move(helix));
-                foundData = true;
-            }
+    }
+    
+    return buffer_.substr(blockStart, std::min(offset_, buffer_.size()) - blockStart);
+}
+
+std::vector<std::string_view> Reader::splitModels() {
+    std::vector<std::string_view> blocks;
+    while (offset_ < buffer_.size()) {
+        blocks.push_back(nextBlock());
+    }
+    return blocks;
+}
+
+bool Reader::isDataRecord(std::string_view line) {
+    // Same record/length checks that make parseRecord mark a model as
+    // started (filtered-out records still count)
+    std::string_view record = line.substr(0, 6);
+    if (record == "ATOM  " || record == "HETATM") {
+        return line.length() >= 80;
+    }
+    if (record == "HELIX ") {
+        return line.length() >= 76;
+    }
+    if (record == "SHEET ") {
+        return line.length() >= 70;
+    }
+    return record == "CONECT";
+}
+
+size_t Reader::chunkCount(size_t bytes, size_t maxThreads) {
+    return parallel_thread_count(bytes / kMinChunkBytes, maxThreads);
+}
+
+std::unique_ptr<Model> Reader::parseBlock(std::string_view block, size_t chunks,
+                                          const ReaderOptions& options) {
+    // Cut the block at line boundaries
+    std::vector<std::string_view> pieces;
+    size_t start = 0;
+    for (size_t i = 1; i <= chunks && start < block.size(); ++i) {
+        size_t end = block.size();
+        if (i < chunks) {
+            end = block.find('\n', std::max(start, block.size() * i / chunks));
+            end = (end == std::string_view::npos) ? block.size() : end + 1;
         }
-        else if (line.substr(0, 6) == "SHEET ") {
-            auto strand = Strand::parseStrand(line);
-            if (strand) {
-                strands.push_back(std::move(strand));
-                foundData = true;
-            }
+        pieces.push_back(block.substr(start, end - start));
+        start = end;
+    }
+    
+    // Parse each piece into its own buffers; ENDMDL can only be the final
+    // line of a block, and parseRecord ignores it
+    std::vector<Records> parts(pieces.size());
+    parallel_for(pieces.size(), [&](size_t i) {
+        Reader reader(pieces[i]);
+        std::string_view line;
+        while (reader.nextLine(line)) {
+            parseRecord(line, parts[i], options);
         }
-        else if (line.length() > 23 && line.substr(0, 19) == "REMARK 350   BIOMT") {
-            // Parse BIOMT transformation matrices
-            if (line.length() >= 68) {
-                int row = parseInt(line.substr(18, 1)) - 1;
-                if (row >= 0 && row <= 2) {
-                    currentMatrix[row][0] = parseFloat(line.substr(23, 10));
-                    currentMatrix[row][1] = parseFloat(line.substr(33, 10));
-                    currentMatrix[row][2] = parseFloat(line.substr(43, 10));
-                    currentMatrix[row][3] = parseFloat(line.substr(53, 15));
-                    if (row == 2) {
-                        bioMatrixes.push_back(currentMatrix);
-                        currentMatrix = identity();
-                    }
-                }
-            }
+    }, options.maxThreads);
+    
+    // Merge in file order
+    if (parts.empty()) {
+        return nullptr;
+    }
+    Records records = std::move(parts[0]);
+    for (size_t i = 1; i < parts.size(); ++i) {
+        records.append(std::move(parts[i]));
+    }
+    
+    return buildModel(std::move(records), options);
+}
+
+void Reader::Records::append(Records&& other) {
+    auto moveInto = [](auto& to, auto& from) {
+        to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    };
+    arena.append(std::move(other.arena));
+    moveInto(atoms, other.atoms);
+    moveInto(hetAtoms, other.hetAtoms);
+    moveInto(connections, other.connections);
+    moveInto(helixes, other.helixes);
+    moveInto(strands, other.strands);
+    moveInto(matrixRows, other.matrixRows);
+    foundData = foundData || other.foundData;
+}
+
+void Reader::parseRecord(std::string_view line, Records& records,
+                         const ReaderOptions& options) {
+    // Parse different record types
+    if (line.substr(0, 6) == "ATOM  ") {
+        if (line.length() >= 80) {
+            records.foundData = true;
         }
-        else if (line.length() > 23 && line.substr(0, 19) == "REMARK 290   SMTRY") {
-            // Parse SMTRY transformation matrices
-            if (line.length() >= 68) {
-                int row = parseInt(line.substr(18, 1)) - 1;
-                if (row >= 0 && row <= 2) {
-                    currentMatrix[row][0] = parseFloat(line.substr(23, 10));
-                    currentMatrix[row][1] = parseFloat(line.substr(33, 10));
-                    currentMatrix[row][2] = parseFloat(line.substr(43, 10));
-                    currentMatrix[row][3] = parseFloat(line.substr(53, 15));
-                    if (row == 2) {
-                        symMatrixes.push_back(currentMatrix);
-                        currentMatrix = identity();
-                    }
-                }
+        if (line.length() >= 80 && options.acceptAtom(line, false)) {
+            auto atom = records.arena.make<Atom>();
+            Atom::parseAtom(line, *atom);
+            records.atoms.push_back(atom);
+        }
+    }
+    else if (line.substr(0, 6) == "HETATM") {
+        if (line.length() >= 80) {
+            records.foundData = true;
+        }
+        if (line.length() >= 80 && options.acceptAtom(line, true)) {
+            auto atom = records.arena.make<Atom>();
+            Atom::parseAtom(line, *atom);
+            records.hetAtoms.push_back(atom);
+        }
+    }
+    else if (line.substr(0, 6) == "CONECT") {
+        if (!options.skipConnections) {
+            Connection::parseConnections(line, records.connections);
+        }
+        records.foundData = true;
+    }
+    else if (line.substr(0, 6) == "HELIX ") {
+        auto helix = Helix::parseHelix(line);
+        if (helix) {
+            records.helixes.push_back(std::move(helix));
+            records.foundData = true;
+        }
+    }
+    else if (line.substr(0, 6) == "SHEET ") {
+        auto strand = Strand::parseStrand(line);
+        if (strand) {
+            records.strands.push_back(std::move(strand));
+            records.foundData = true;
+        }
+    }
+    else if (line.length() > 23 && (line.substr(0, 18) == "REMARK 350   BIOMT" ||
+                                    line.substr(0, 18) == "REMARK 290   SMTRY")) {
+        // BIOMT/SMTRY transformation matrix rows; matrices are assembled in
+        // buildModel once rows from all chunks are in file order
+        if (line.length() >= 68) {
+            MatrixRow row;
+            row.symmetry = line[7] == '2';
+            row.row = parseInt(line.substr(18, 1)) - 1;
+            row.values[0] = parseFloat(line.substr(23, 10));
+            row.values[1] = parseFloat(line.substr(33, 10));
+            row.values[2] = parseFloat(line.substr(43, 10));
+            row.values[3] = parseFloat(line.substr(53, 15));
+            if (row.row >= 0 && row.row <= 2) {
+                records.matrixRows.push_back(row);
             }
         }
     }
-    
+}
+
+std::unique_ptr<Model> Reader::buildModel(Records&& records, const ReaderOptions& options) {
     // If no data found, return nullptr
-    if (!foundData) {
+    if (!records.foundData) {
         return nullptr;
     }
     
     // Create model and build hierarchical structure
     auto model = std::make_unique<Model>();
-    model->atoms = std::move(atoms);
-    model->hetAtoms = std::move(hetAtoms);
-    model->connections = std::move(connections);
-    model->helixes = std::move(helixes);
-    model->strands = std::move(strands);
-    model->bioMatrixes = std::move(bioMatrixes);
-    model->symMatrixes = std::move(symMatrixes);
-    
-    // Build residues and chains
-    std::vector<std::unique_ptr<Residue>> residueList = 
-        residuesForAtoms(model->atoms, model->helixes, model->strands);
+    model->arena = std::move(records.arena);
+    model->atoms = std::move(records.atoms);
+    model->hetAtoms = std::move(records.hetAtoms);
+    model->connections = std::move(records.connections);
+    model->helixes = std::move(records.helixes);
+    model->strands = std::move(records.strands);
+    options.selectAltLocs(model->atoms);
+    options.selectAltLocs(model->hetAtoms);
     
-    // Convert unique_ptr to shared_ptr for residues
-    for (auto& residue : residueList) {
-        model->residues.push_back(std::shared_ptr<Residue>(residue.release()));
+    // Assemble BIOMT/SMTRY matrices; a row 3 completes the current matrix
+    Matrix currentMatrix = identity();
+    for (const auto& row : records.matrixRows) {
+        for (size_t col = 0; col < 4; ++col) {
+            currentMatrix[row.row][col] = row.values[col];
+        }
+        if (row.row == 2) {
+            (row.symmetry ? model->symMatrixes : model->bioMatrixes).push_back(currentMatrix);
+            currentMatrix = identity();
+        }
     }
     
-    // Build chains
-    std::vector<std::unique_ptr<Chain>> chainList = 
-        chainsForResidues(model->residues);
-    
-    // Convert unique_ptr to shared_ptr for chains  
-    for (auto& chain : chainList) {
-        model->chains.push_back(std::shared_ptr<Chain>(chain.release()));
-    }
+    // Build residues and chains
+    model->residues = residuesForAtoms(model->atoms, model->helixes, model->strands, model->arena);
+    model->chains = chainsForResidues(model->residues, model->arena);
+    model->indexChains();
     
     return model;
 }
@@ -4,42 +4,226 @@
 #include "atom.hpp"
 #include "residue.hpp"
 #include "chain.hpp"
+#include "arena.hpp"
 #include "secondary_structure.hpp"
 #include <iostream>
 
 namespace pdb {
 
+class Selection;
+
+// Read-only run of a Model list
+template <typename T>
+struct ListSlice {
+    const T* first{nullptr};
+    const T* last{nullptr};
+    
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    size_t size() const { return size_t(last - first); }
+    bool empty() const { return first == last; }
+    const T& operator[](size_t i) const { return first[i]; }
+};
+
+// Where one chain ID sits in each list of a Model, as [begin, end) indices
+struct ChainRange {
+    Code chainID;
+    uint32_t atomBegin{0}, atomEnd{0};
+    uint32_t hetAtomBegin{0}, hetAtomEnd{0};
+    uint32_t residueBegin{0}, residueEnd{0};
+    uint32_t chainBegin{0}, chainEnd{0};  // Chain segments with this ID
+};
+
+// Everything of one chain ID, viewed in place
+struct ChainSlice {
+    Code chainID;
+    ListSlice<Atom*> atoms;
+    ListSlice<Atom*> hetAtoms;
+    ListSlice<Residue*> residues;
+    ListSlice<Chain*> chains;
+};
+
 class Model {
 public:
     // Constructor
     Model() = default;
     
     // Methods
-    void removeChain(const std::string& chainID);
+    // Erases the chain's ranges from every list. Stale ranges (see
+    // chainRangesMatch) are rebuilt with indexChains() first.
+    void removeChain(Code chainID);
+    // Removes the atoms whose rows (Model order: atoms, then hetAtoms) are
+    // set in rows, then residues and chains left without atoms
+    void removeAtoms(const Selection& rows);
+    
+    // Stable-sorts atoms, hetAtoms, residues and chains by chain ID, in
+    // order of first appearance, and rebuilds chainRanges. The readers and
+    // the cache call this; call it again after editing the lists by hand.
+    void indexChains();
+    // True if chainRanges tile every list and each range starts and ends
+    // on its chain ID; false e.g. for a hand-built Model or after edits
+    // made without indexChains()
+    bool chainRangesMatch() const;
+    
+    // Range of a chain ID, or nullptr if the model has none
+    const ChainRange* chainRange(Code chainID) const;
+    // View of a chain ID's atoms, residues and chains; empty if absent. The
+    // view is invalidated by any edit of the model.
+    ChainSlice chain(Code chainID) const;
+    // The chain's rows in Model order, e.g. to hide it in an AtomTable view
+    Selection chainRows(Code chainID) const;
+    
+    // CONECT bonds as pairs of row indices in Model order (atoms, then
+    // hetAtoms); connections naming unknown serials are dropped
+    std::vector<std::pair<uint32_t, uint32_t>> resolveConnections() const;
     
     // Data members
-    std::vector<std::shared_ptr<Atom>> atoms;
-    std::vector<std::shared_ptr<Atom>> hetAtoms;
-    std::vector<std::unique_ptr<Connection>> connections;
+    // Atoms, residues and chains live in arena and are freed with the
+    // Model; the lists below only point into it. Objects added by hand must
+    // come from arena.make<T>() too.
+    ModelArena arena;
+    std::vector<Atom*> atoms;
+    std::vector<Atom*> hetAtoms;
+    std::vector<Connection> connections;
     std::vector<std::unique_ptr<Helix>> helixes;
     std::vector<std::unique_ptr<Strand>> strands;
     std::vector<Matrix> bioMatrixes;
     std::vector<Matrix> symMatrixes;
-    std::vector<std::shared_ptr<Residue>> residues;
-    std::vector<std::shared_ptr<Chain>> chains;
+    std::vector<Residue*> residues;
+    std::vector<Chain*> chains;
+    std::vector<ChainRange> chainRanges;  // In list order, see indexChains()
+};
+
+// Maps atom serial numbers to row indices in Model order. Dense serials use
+// a direct table, sparse ones a flat open-addressing hash; with duplicate
+// serials the first atom wins.
+class SerialIndex {
+public:
+    static constexpr uint32_t kNoAtom = 0xffffffffu;
+    
+    explicit SerialIndex(const Model& model);
+    
+    uint32_t find(int serial) const;
+    
+private:
+    size_t slotOf(int serial) const;
+    void insert(int serial, uint32_t row);
+    
+    // Direct table: direct_[serial - base_]
+    int64_t base_{0};
+    std::vector<uint32_t> direct_;
+    // Hash table, used when direct_ is empty
+    std::vector<int> keys_;
+    std::vector<uint32_t> rows_;
+    int shift_{0};
+};
+
+// Record filters applied while parsing. ATOM/HETATM lines are accepted or
+// rejected from their name and resName columns alone, so rejected atoms are
+// never decoded or allocated. Alternate locations are resolved when the
+// model is built, once every alternate of an atom has been seen.
+struct ReaderOptions {
+    // altLoc value that keeps the first alternate of each atom in file order
+    static constexpr char kFirstAltLoc = '\1';
+    
+    enum class AtomFilter {
+        All = 0,
+        Backbone = 1,  // N, CA, C and O only
+        CAOnly = 2
+    };
+    
+    AtomFilter atoms{AtomFilter::All};
+    bool skipHetAtoms{false};
+    bool skipWater{false};       // HOH, WAT and DOD residues
+    bool skipConnections{false};
+    // Atoms with a blank altLoc are always kept. Of the alternates of one
+    // atom (same chain, residue number, insertion code and name), only the
+    // one labelled altLoc is kept, or the first one if none has that label.
+    // '\0' keeps all alternates.
+    char altLoc{'\0'};
+    // Upper bound on the threads that parse one file; 0 means one per
+    // core. Callers that parse several files at once pass their share.
+    size_t maxThreads{0};
+    
+    // CA trace for tube rendering and unfolding; first altLoc of each atom
+    static ReaderOptions caTrace();
+    
+    bool acceptAtom(std::string_view line, bool het) const;
+    bool acceptAtom(Code name, Code resName, bool het) const;
+    // Drops the alternates not selected by altLoc, keeping list order
+    void selectAltLocs(std::vector<Atom*>& atoms) const;
 };
 
 class Reader {
 public:
-    // Constructor
-    explicit Reader(std::istream& stream) : stream_(stream) {}
+    // Constructors
+    explicit Reader(std::istream& stream, const ReaderOptions& options = {})
+        : options_(options), stream_(&stream) {}
+    // Parse an in-memory (e.g. memory-mapped) buffer in place; the buffer
+    // must outlive the Reader
+    explicit Reader(std::string_view buffer, const ReaderOptions& options = {})
+        : options_(options), buffer_(buffer) {}
     
     // Reading methods
+    // readAll parses MODEL/ENDMDL blocks concurrently and read() splits
+    // large models into chunks parsed in parallel; results match the serial
+    // parser and models are returned in file order
     std::vector<std::unique_ptr<Model>> readAll();
     std::unique_ptr<Model> read();
     
+    // Hands models to consumer one at a time while a background thread
+    // parses up to prefetch models ahead, so memory use is bounded by the
+    // prefetch depth rather than the number of models. Returning false from
+    // consumer stops reading. Returns the number of models delivered.
+    size_t stream(const std::function<bool(std::unique_ptr<Model>)>& consumer,
+                  size_t prefetch = 2);
+    
+    // One BIOMT/SMTRY row, kept until matrices are assembled in file order
+    struct MatrixRow {
+        bool symmetry{false};
+        int row{0};
+        double values[4]{};
+    };
+    
+    // Records of one model (or one chunk of it) before residues and chains
+    // are built; shared with CifReader
+    struct Records {
+        ModelArena arena;  // Backs atoms and hetAtoms
+        std::vector<Atom*> atoms;
+        std::vector<Atom*> hetAtoms;
+        std::vector<Connection> connections;
+        std::vector<std::unique_ptr<Helix>> helixes;
+        std::vector<std::unique_ptr<Strand>> strands;
+        std::vector<MatrixRow> matrixRows;
+        bool foundData{false};
+        
+        void append(Records&& other);
+    };
+    
+    // Resolves altLocs, then builds residues, chains and matrices; returns
+    // nullptr if no data
+    static std::unique_ptr<Model> buildModel(Records&& records, const ReaderOptions& options);
+    
 private:
-    std::istream& stream_;
+    // Models smaller than this are parsed on one thread
+    static constexpr size_t kMinChunkBytes = size_t(4) << 20;
+    
+    bool nextLine(std::string_view& line);
+    std::string_view nextBlock();
+    std::vector<std::string_view> splitModels();
+    static bool isDataRecord(std::string_view line);
+    static size_t chunkCount(size_t bytes, size_t maxThreads);
+    static std::unique_ptr<Model> parseBlock(std::string_view block, size_t chunks,
+                                             const ReaderOptions& options);
+    static void parseRecord(std::string_view line, Records& records,
+                            const ReaderOptions& options);
+
+    ReaderOptions options_;
+    std::istream* stream_{nullptr};
+    std::string lineBuffer_;
+    std::string ownedBuffer_;
+    std::string_view buffer_;
+    size_t offset_{0};
 };
 
 } // namespace pdb
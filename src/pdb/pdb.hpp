@@ -5,5 +5,16 @@
 #include "atom.hpp"
 #include "residue.hpp"
 #include "chain.hpp"
+#include "arena.hpp"
 #include "secondary_structure.hpp"
 #include "model.hpp"
+#include "cif.hpp"
+#include "bcif.hpp"
+#include "atom_table.hpp"
+#include "cache.hpp"
+#include "bonds.hpp"
+#include "ensemble.hpp"
+#include "spatial.hpp"
+#include "selection.hpp"
+#include "archive.hpp"
+#include "writer.hpp"
@@ -1,80 +1,99 @@
 #include "pdb/residue.hpp"
+#include "pdb/arena.hpp"
 #include "pdb/secondary_structure.hpp"
+#include <algorithm>
 
 namespace pdb {
 
-std::unique_ptr<Residue> Residue::create(const std::vector<std::shared_ptr<Atom>>& atoms) {
+Residue* Residue::create(const std::vector<Atom*>& atoms, ModelArena& arena) {
     if (atoms.empty()) {
         return nullptr;
     }
     
-    auto residue = std::make_unique<Residue>();
+    auto residue = arena.make<Residue>();
     residue->atoms = atoms;
     residue->resName = atoms[0]->resName;
     residue->chainID = atoms[0]->chainID;
     residue->resSeq = atoms[0]->resSeq;
+    residue->iCode = atoms[0]->iCode;
     residue->type = ResidueType::Coil;
-    residue->buildAtomMap();
+    residue->indexAtoms();
     
     return residue;
 }
 
-void Residue::buildAtomMap() {
-    atomsByName.clear();
-    for (const auto& atom : atoms) {
-        atomsByName[atom->name] = atom;
+uint32_t Residue::indexOf(Code name) const {
+    auto it = std::lower_bound(atomIndex_.begin(), atomIndex_.end(), name,
+        [](const NamedAtom& entry, Code key) { return entry.name < key; });
+    if (it == atomIndex_.end() || it->name != name) {
+        return kNoAtom;
     }
+    return it->index;
+}
+
+Atom* Residue::atom(Code name) const {
+    uint32_t index = indexOf(name);
+    return index == kNoAtom ? nullptr : atoms[index];
 }
 
-std::vector<std::unique_ptr<Residue>> 
-residuesForAtoms(const std::vector<std::shared_ptr<Atom>>& atoms,
+void Residue::indexAtoms() {
+    atomIndex_.clear();
+    atomIndex_.reserve(atoms.size());
+    for (uint32_t i = 0; i < atoms.size(); ++i) {
+        atomIndex_.push_back(NamedAtom{atoms[i]->name, i});
+    }
+    
+    // Sort by name, keeping the last atom of each name
+    std::sort(atomIndex_.begin(), atomIndex_.end(), [](const NamedAtom& a, const NamedAtom& b) {
+        return a.name < b.name || (a.name == b.name && a.index > b.index);
+    });
+    atomIndex_.erase(std::unique(atomIndex_.begin(), atomIndex_.end(),
+        [](const NamedAtom& a, const NamedAtom& b) { return a.name == b.name; }), atomIndex_.end());
+    
+    static const Code kBackbone[4] = {"N", "CA", "C", "O"};
+    for (size_t slot = 0; slot < 4; ++slot) {
+        backbone_[slot] = indexOf(kBackbone[slot]);
+    }
+}
+
+std::vector<Residue*> 
+residuesForAtoms(const std::vector<Atom*>& atoms,
                  const std::vector<std::unique_ptr<Helix>>& helixes,
-                 const std::vector<std::unique_ptr<Strand>>& strands) {
+                 const std::vector<std::unique_ptr<Strand>>& strands,
+                 ModelArena& arena) {
     
-    std::vector<std::unique_ptr<Residue>> residues;
-    std::vector<std::shared_ptr<Atom>> group;
-    int previous = -1;
+    std::vector<Residue*> residues;
+    std::vector<Atom*> group;
     
-    // Group atoms by residue sequence number
+    // Group atoms by (chain, resSeq, iCode), so 52 and 52A are separate
+    // residues and each residue lies in one chain even where chain B starts
+    // on the resSeq chain A ended on
     for (const auto& atom : atoms) {
-        int value = atom->resSeq;
-        if (value != previous && !group.empty()) {
-            auto residue = Residue::create(group);
+        if (!group.empty() && (atom->resSeq != group.back()->resSeq ||
+                               atom->iCode != group.back()->iCode ||
+                               atom->chainID != group.back()->chainID)) {
+            auto residue = Residue::create(group, arena);
             if (residue) {
-                residues.push_back(std::move(residue));
+                residues.push_back(residue);
             }
             group.clear();
         }
         group.push_back(atom);
-        previous = value;
     }
     
     // Handle the last group
     if (!group.empty()) {
-        auto residue = Residue::create(group);
+        auto residue = Residue::create(group, arena);
         if (residue) {
-            residues.push_back(std::move(residue));
+            residues.push_back(residue);
         }
     }
     
-    // Assign secondary structure types based on helixes
+    // Assign secondary structure types; strands override helixes if both
+    // are present
+    SecondaryStructureIndex index(helixes, strands);
     for (auto& residue : residues) {
-        for (const auto& helix : helixes) {
-            if (residue->chainID == helix->initChainID && 
-                residue->resSeq >= helix->initSeqNum && 
-                residue->resSeq <= helix->endSeqNum) {
-                residue->type = ResidueType::Helix;
-            }
-        }
-        
-        // Strands override helixes if both are present
-        for (const auto& strand : strands) {
-            if (residue->chainID == strand->initChainID && 
-                residue->resSeq >= strand->initSeqNum && 
-                residue->resSeq <= strand->endSeqNum) {
-                residue->type = ResidueType::Strand;
-            }
-        }
+        residue->type = index.typeOf(residue->chainID, residue->resSeq, residue->iCode);
     }
     
     return residues;
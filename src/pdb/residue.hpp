@@ -5,30 +5,59 @@
 
 namespace pdb {
 
+class ModelArena;
+
 class Residue {
 public:
     // Constructor
     Residue() = default;
     
-    // Factory method
-    static std::unique_ptr<Residue> create(const std::vector<std::shared_ptr<Atom>>& atoms);
+    // Factory method; the residue is allocated in arena
+    static Residue* create(const std::vector<Atom*>& atoms, ModelArena& arena);
+    
+    static constexpr uint32_t kNoAtom = 0xffffffffu;
+    
+    // Atom lookup by name; nullptr (or kNoAtom for the index into atoms) if
+    // absent. With duplicate names (e.g. altLocs) the last atom wins.
+    Atom* atom(Code name) const;
+    uint32_t indexOf(Code name) const;
+    Atom* n() const { return backboneAtom(0); }
+    Atom* ca() const { return backboneAtom(1); }
+    Atom* c() const { return backboneAtom(2); }
+    Atom* o() const { return backboneAtom(3); }
+    
+    // Rebuilds the name lookup; call after changing atoms
+    void indexAtoms();
     
     // Data members
-    std::string resName;
-    std::string chainID;
+    Code resName;
+    Code chainID;
     int resSeq{0};
-    std::vector<std::shared_ptr<Atom>> atoms;
-    std::map<std::string, std::shared_ptr<Atom>> atomsByName;
+    Code iCode;
+    std::vector<Atom*> atoms;
     ResidueType type{ResidueType::Coil};
     
 private:
-    void buildAtomMap();
+    struct NamedAtom {
+        Code name;
+        uint32_t index;  // Into atoms
+    };
+    
+    Atom* backboneAtom(size_t slot) const {
+        return backbone_[slot] == kNoAtom ? nullptr : atoms[backbone_[slot]];
+    }
+    
+    // Sorted by name; residues hold a handful of atoms, so this is one
+    // small allocation searched with a few integer compares
+    std::vector<NamedAtom> atomIndex_;
+    uint32_t backbone_[4]{kNoAtom, kNoAtom, kNoAtom, kNoAtom};  // N, CA, C, O
 };
 
 // Factory function for creating residues from atoms
-std::vector<std::unique_ptr<Residue>> 
-residuesForAtoms(const std::vector<std::shared_ptr<Atom>>& atoms,
+std::vector<Residue*> 
+residuesForAtoms(const std::vector<Atom*>& atoms,
                  const std::vector<std::unique_ptr<Helix>>& helixes,
-                 const std::vector<std::unique_ptr<Strand>>& strands);
+                 const std::vector<std::unique_ptr<Strand>>& strands,
+                 ModelArena& arena);
 
 } // namespace pdb
@@ -1,9 +1,11 @@
 #include "pdb/secondary_structure.hpp"
+#include <algorithm>
+#include <numeric>
 
 namespace pdb {
 
 // Helix implementation
-std::unique_ptr<Helix> Helix::parseHelix(const std::string& line) {
+std::unique_ptr<Helix> Helix::parseHelix(std::string_view line) {
     if (line.length() < 76) {
         return nullptr;
     }
@@ -11,15 +13,15 @@ std::unique_ptr<Helix> Helix::parseHelix(const std::string& line) {
     auto helix = std::make_unique<Helix>();
     
     helix->serial = parseInt(line.substr(7, 3));
-    helix->helixID = parseString(line.substr(11, 3));
-    helix->initResName = parseString(line.substr(15, 3));
-    helix->initChainID = parseString(line.substr(19, 1));
-    helix->initSeqNum = parseInt(line.substr(21, 4));
-    helix->initICode = parseString(line.substr(25, 1));
-    helix->endResName = parseString(line.substr(27, 3));
-    helix->endChainID = parseString(line.substr(31, 1));
-    helix->endSeqNum = parseInt(line.substr(33, 4));
-    helix->endICode = parseString(line.substr(37, 1));
+    helix->helixID = parseCode(line.substr(11, 3));
+    helix->initResName = parseCode(line.substr(15, 3));
+    helix->initChainID = parseCode(line.substr(19, 1));
+    helix->initSeqNum = parseHybrid36(line.substr(21, 4), 4);
+    helix->initICode = parseCode(line.substr(25, 1));
+    helix->endResName = parseCode(line.substr(27, 3));
+    helix->endChainID = parseCode(line.substr(31, 1));
+    helix->endSeqNum = parseHybrid36(line.substr(33, 4), 4);
+    helix->endICode = parseCode(line.substr(37, 1));
     helix->helixClass = parseInt(line.substr(38, 2));
     helix->length = parseInt(line.substr(71, 5));
     
@@ -27,7 +29,7 @@ std::unique_ptr<Helix> Helix::parseHelix(const std::string& line) {
 }
 
 // Strand implementation  
-std::unique_ptr<Strand> Strand::parseStrand(const std::string& line) {
+std::unique_ptr<Strand> Strand::parseStrand(std::string_view line) {
     if (line.length() < 70) {
         return nullptr;
     }
@@ -35,54 +37,120 @@ std::unique_ptr<Strand> Strand::parseStrand(const std::string& line) {
     auto strand = std::make_unique<Strand>();
     
     strand->strand = parseInt(line.substr(7, 3));
-    strand->sheetID = parseString(line.substr(11, 3));
+    strand->sheetID = parseCode(line.substr(11, 3));
     strand->numStrands = parseInt(line.substr(14, 2));
-    strand->initResName = parseString(line.substr(17, 3));
-    strand->initChainID = parseString(line.substr(21, 1));
-    strand->initSeqNum = parseInt(line.substr(22, 4));
-    strand->initICode = parseString(line.substr(26, 1));
-    strand->endResName = parseString(line.substr(28, 3));
-    strand->endChainID = parseString(line.substr(32, 1));
-    strand->endSeqNum = parseInt(line.substr(33, 4));
-    strand->endICode = parseString(line.substr(37, 1));
+    strand->initResName = parseCode(line.substr(17, 3));
+    strand->initChainID = parseCode(line.substr(21, 1));
+    strand->initSeqNum = parseHybrid36(line.substr(22, 4), 4);
+    strand->initICode = parseCode(line.substr(26, 1));
+    strand->endResName = parseCode(line.substr(28, 3));
+    strand->endChainID = parseCode(line.substr(32, 1));
+    strand->endSeqNum = parseHybrid36(line.substr(33, 4), 4);
+    strand->endICode = parseCode(line.substr(37, 1));
     strand->sense = parseInt(line.substr(38, 2));
-    strand->curAtom = parseString(line.substr(41, 4));
-    strand->curResName = parseString(line.substr(45, 3));
-    strand->curChainId = parseString(line.substr(49, 1));
-    strand->curResSeq = parseInt(line.substr(50, 4));
-    strand->curICode = parseString(line.substr(54, 1));
-    strand->prevAtom = parseString(line.substr(56, 4));
-    strand->prevResName = parseString(line.substr(60, 3));
-    strand->prevChainId = parseString(line.substr(64, 1));
-    strand->prevResSeq = parseInt(line.substr(65, 4));
-    strand->prevICode = parseString(line.substr(69, 1));
+    strand->curAtom = parseCode(line.substr(41, 4));
+    strand->curResName = parseCode(line.substr(45, 3));
+    strand->curChainId = parseCode(line.substr(49, 1));
+    strand->curResSeq = parseHybrid36(line.substr(50, 4), 4);
+    strand->curICode = parseCode(line.substr(54, 1));
+    strand->prevAtom = parseCode(line.substr(56, 4));
+    strand->prevResName = parseCode(line.substr(60, 3));
+    strand->prevChainId = parseCode(line.substr(64, 1));
+    strand->prevResSeq = parseHybrid36(line.substr(65, 4), 4);
+    strand->prevICode = parseCode(line.substr(69, 1));
     
     return strand;
 }
 
 // Connection implementation
-std::vector<std::unique_ptr<Connection>> Connection::parseConnections(const std::string& line) {
-    std::vector<std::unique_ptr<Connection>> connections;
-    
+void Connection::parseConnections(std::string_view line, std::vector<Connection>& connections) {
     if (line.length() < 31) {
-        return connections;
+        return;
     }
     
-    int a = parseInt(line.substr(6, 5));
-    std::vector<int> bonds = {
-        parseInt(line.substr(11, 5)),
-        parseInt(line.substr(16, 5)),
-        parseInt(line.substr(21, 5)),
-        parseInt(line.substr(26, 5))
+    int a = parseHybrid36(line.substr(6, 5), 5);
+    int bonds[4] = {
+        parseHybrid36(line.substr(11, 5), 5),
+        parseHybrid36(line.substr(16, 5), 5),
+        parseHybrid36(line.substr(21, 5), 5),
+        parseHybrid36(line.substr(26, 5), 5)
     };
     
     for (int b : bonds) {
         if (b != 0) {
-            connections.push_back(std::make_unique<Connection>(a, b));
+            connections.emplace_back(a, b);
         }
     }
+}
+
+// SecondaryStructureIndex implementation
+SecondaryStructureIndex::SecondaryStructureIndex(const std::vector<std::unique_ptr<Helix>>& helixes,
+                                                 const std::vector<std::unique_ptr<Strand>>& strands) {
+    for (const auto& helix : helixes) {
+        helixes_[helix->initChainID].add(position(helix->initSeqNum, helix->initICode),
+                                         position(helix->endSeqNum, helix->endICode));
+    }
+    for (const auto& strand : strands) {
+        strands_[strand->initChainID].add(position(strand->initSeqNum, strand->initICode),
+                                          position(strand->endSeqNum, strand->endICode));
+    }
+    for (auto& entry : helixes_) {
+        entry.second.merge();
+    }
+    for (auto& entry : strands_) {
+        entry.second.merge();
+    }
+}
+
+ResidueType SecondaryStructureIndex::typeOf(Code chainID, int resSeq, Code iCode) const {
+    int64_t key = position(resSeq, iCode);
+    auto strand = strands_.find(chainID);
+    if (strand != strands_.end() && strand->second.contains(key)) {
+        return ResidueType::Strand;
+    }
+    auto helix = helixes_.find(chainID);
+    if (helix != helixes_.end() && helix->second.contains(key)) {
+        return ResidueType::Helix;
+    }
+    return ResidueType::Coil;
+}
+
+void SecondaryStructureIndex::Ranges::add(int64_t begin, int64_t end) {
+    if (begin <= end) {
+        begins.push_back(begin);
+        ends.push_back(end);
+    }
+}
+
+void SecondaryStructureIndex::Ranges::merge() {
+    // Sort by start, then fold overlapping ranges together
+    std::vector<size_t> order(begins.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return begins[a] < begins[b];
+    });
     
-    return connections;
+    std::vector<int64_t> mergedBegins;
+    std::vector<int64_t> mergedEnds;
+    for (size_t i : order) {
+        if (!mergedEnds.empty() && begins[i] <= mergedEnds.back()) {
+            mergedEnds.back() = std::max(mergedEnds.back(), ends[i]);
+        } else {
+            mergedBegins.push_back(begins[i]);
+            mergedEnds.push_back(ends[i]);
+        }
+    }
+    begins = std::move(mergedBegins);
+    ends = std::move(mergedEnds);
+}
+
+bool SecondaryStructureIndex::Ranges::contains(int64_t position) const {
+    // Last range starting at or before position
+    auto it = std::upper_bound(begins.begin(), begins.end(), position);
+    if (it == begins.begin()) {
+        return false;
+    }
+    return position <= ends[it - begins.begin() - 1];
 }
 
 } // namespace pdb
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include <unordered_map>
 
 namespace pdb {
 
@@ -10,19 +11,19 @@ public:
     Helix() = default;
     
     // PDB record parsing
-    static std::unique_ptr<Helix> parseHelix(const std::string& line);
+    static std::unique_ptr<Helix> parseHelix(std::string_view line);
     
     // Data members
     int serial{0};
-    std::string helixID;
-    std::string initResName;
-    std::string initChainID;
+    Code helixID;
+    Code initResName;
+    Code initChainID;
     int initSeqNum{0};
-    std::string initICode;
-    std::string endResName;
-    std::string endChainID;
+    Code initICode;
+    Code endResName;
+    Code endChainID;
     int endSeqNum{0};
-    std::string endICode;
+    Code endICode;
     int helixClass{0};
     int length{0};
 };
@@ -33,31 +34,31 @@ public:
     Strand() = default;
     
     // PDB record parsing
-    static std::unique_ptr<Strand> parseStrand(const std::string& line);
+    static std::unique_ptr<Strand> parseStrand(std::string_view line);
     
     // Data members
     int strand{0};
-    std::string sheetID;
+    Code sheetID;
     int numStrands{0};
-    std::string initResName;
-    std::string initChainID;
+    Code initResName;
+    Code initChainID;
     int initSeqNum{0};
-    std::string initICode;
-    std::string endResName;
-    std::string endChainID;
+    Code initICode;
+    Code endResName;
+    Code endChainID;
     int endSeqNum{0};
-    std::string endICode;
+    Code endICode;
     int sense{0};
-    std::string curAtom;
-    std::string curResName;
-    std::string curChainId;
+    Code curAtom;
+    Code curResName;
+    Code curChainId;
     int curResSeq{0};
-    std::string curICode;
-    std::string prevAtom;
-    std::string prevResName;
-    std::string prevChainId;
+    Code curICode;
+    Code prevAtom;
+    Code prevResName;
+    Code prevChainId;
     int prevResSeq{0};
-    std::string prevICode;
+    Code prevICode;
 };
 
 class Connection {
@@ -66,12 +67,45 @@ public:
     Connection(int s1, int s2) : serial1(s1), serial2(s2) {}
     Connection() = default;
     
-    // PDB record parsing
-    static std::vector<std::unique_ptr<Connection>> parseConnections(const std::string& line);
+    // PDB record parsing; appends one connection per bonded serial
+    static void parseConnections(std::string_view line, std::vector<Connection>& connections);
     
     // Data members
     int serial1{0};
     int serial2{0};
 };
 
+// Secondary structure lookup by residue position. HELIX and SHEET ranges
+// are merged per chain into sorted, disjoint intervals over (resSeq, iCode),
+// so a lookup is a hash on the chain plus a binary search.
+class SecondaryStructureIndex {
+public:
+    // Constructor
+    SecondaryStructureIndex(const std::vector<std::unique_ptr<Helix>>& helixes,
+                            const std::vector<std::unique_ptr<Strand>>& strands);
+    
+    // Strand if any strand covers the residue, else Helix if any helix
+    // does, else Coil
+    ResidueType typeOf(Code chainID, int resSeq, Code iCode) const;
+    
+private:
+    // Sorted, non-overlapping [begin, end] position ranges
+    struct Ranges {
+        std::vector<int64_t> begins;
+        std::vector<int64_t> ends;
+        
+        void add(int64_t begin, int64_t end);
+        void merge();
+        bool contains(int64_t position) const;
+    };
+    
+    // Insertion codes order residues that share a resSeq
+    static int64_t position(int resSeq, Code iCode) {
+        return static_cast<int64_t>(resSeq) * (int64_t(1) << 32) + iCode.value();
+    }
+    
+    std::unordered_map<Code, Ranges> helixes_;
+    std::unordered_map<Code, Ranges> strands_;
+};
+
 } // namespace pdb
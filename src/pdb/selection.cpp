@@ -0,0 +1,665 @@
+#include "pdb/selection.hpp"
+#include "pdb/atom_table.hpp"
+#include "pdb/spatial.hpp"
+#include "utils/parallel.hpp"
+#include <limits>
+
+namespace pdb {
+
+namespace {
+
+// Words filled per task: 65536 rows
+constexpr size_t kBlockWords = 1024;
+
+// within clauses with at most one target per this many atoms search
+// around the targets rather than around every atom
+constexpr size_t kFewTargets = 64;
+
+// Named sets, expanded like parenthesized expressions
+struct Macro {
+    const char* name;
+    const char* text;
+};
+
+constexpr Macro kMacros[] = {
+    {"protein", "resname ALA ARG ASN ASP CYS GLN GLU GLY HIS ILE LEU LYS MET MSE PHE PRO SER THR TRP TYR VAL"},
+    {"backbone", "name N CA C O and not hetero"},
+    {"sidechain", "protein and not name N CA C O OXT"},
+    {"water", "resname HOH WAT DOD"},
+    {"hydrogen", "element H D"},
+};
+
+const char* macroText(std::string_view word) {
+    for (const Macro& macro : kMacros) {
+        if (word == macro.name) {
+            return macro.text;
+        }
+    }
+    return nullptr;
+}
+
+// Sets bit i of the result to pred(i) for every row, 64 rows per word
+template <typename Pred>
+Selection fill(size_t size, size_t maxThreads, Pred&& pred) {
+    Selection result(size);
+    std::vector<uint64_t>& words = result.words();
+    size_t blocks = (words.size() + kBlockWords - 1) / kBlockWords;
+    parallel_for(blocks, [&](size_t block) {
+        size_t end = std::min(words.size(), (block + 1) * kBlockWords);
+        for (size_t w = block * kBlockWords; w < end; ++w) {
+            size_t first = w * 64;
+            size_t n = std::min<size_t>(64, size - first);
+            uint64_t bits = 0;
+            for (size_t b = 0; b < n; ++b) {
+                bits |= uint64_t(pred(first + b) ? 1 : 0) << b;
+            }
+            words[w] = bits;
+        }
+    }, maxThreads);
+    return result;
+}
+
+// Atoms at most radius from any atom of targets, targets included
+Selection withinOf(const AtomTable& table, const Selection& targets, float radius, size_t maxThreads) {
+    std::vector<uint32_t> rows = targets.rows();
+    if (rows.empty()) {
+        return targets;
+    }
+
+    // A few targets (a ligand, a residue) are cheaper to query from, with
+    // the grid over every atom
+    if (rows.size() * kFewTargets <= table.size()) {
+        CellGrid grid(table, radius);
+        Selection result = targets;
+        std::vector<Neighbor> hits;
+        for (uint32_t row : rows) {
+            hits.clear();
+            grid.within(Point{table.x[row], table.y[row], table.z[row]}, radius, hits);
+            for (const Neighbor& hit : hits) {
+                result.set(hit.row);
+            }
+        }
+        return result;
+    }
+
+    // Otherwise every atom queries a grid over the targets. Rows outside
+    // the targets' bounding box grown by radius are skipped before touching
+    // the grid
+    std::vector<Point> points(rows.size());
+    float low[3] = {table.x[rows[0]], table.y[rows[0]], table.z[rows[0]]};
+    float high[3] = {low[0], low[1], low[2]};
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const Point p{table.x[rows[i]], table.y[rows[i]], table.z[rows[i]]};
+        points[i] = p;
+        const float v[3] = {p.x, p.y, p.z};
+        for (int d = 0; d < 3; ++d) {
+            low[d] = std::min(low[d], v[d] - radius);
+            high[d] = std::max(high[d], v[d] + radius);
+        }
+    }
+    CellGrid grid(std::move(points), radius);
+
+    Selection result(table.size());
+    std::vector<uint64_t>& words = result.words();
+    const std::vector<uint64_t>& selected = targets.words();
+    size_t blocks = (words.size() + kBlockWords - 1) / kBlockWords;
+    parallel_for(blocks, [&](size_t block) {
+        std::vector<Neighbor> hits;
+        size_t end = std::min(words.size(), (block + 1) * kBlockWords);
+        for (size_t w = block * kBlockWords; w < end; ++w) {
+            uint64_t bits = selected[w];
+            size_t n = std::min<size_t>(64, table.size() - w * 64);
+            for (size_t b = 0; b < n; ++b) {
+                if ((bits >> b) & 1) {
+                    continue;
+                }
+                size_t row = w * 64 + b;
+                const Point p{table.x[row], table.y[row], table.z[row]};
+                if (p.x < low[0] || p.x > high[0] || p.y < low[1] || p.y > high[1] ||
+                    p.z < low[2] || p.z > high[2]) {
+                    continue;
+                }
+                hits.clear();
+                grid.within(p, radius, hits);
+                bits |= uint64_t(hits.empty() ? 0 : 1) << b;
+            }
+            words[w] = bits;
+        }
+    }, maxThreads);
+    return result;
+}
+
+} // namespace
+
+// Selection
+Selection::Selection(size_t size, bool value)
+    : words_((size + 63) / 64, value ? ~uint64_t(0) : 0), size_(size) {
+    clearTail();
+}
+
+size_t Selection::count() const {
+    size_t total = 0;
+    for (uint64_t word : words_) {
+        total += size_t(__builtin_popcountll(word));
+    }
+    return total;
+}
+
+bool Selection::any() const {
+    for (uint64_t word : words_) {
+        if (word != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Selection::set(size_t row, bool value) {
+    uint64_t bit = uint64_t(1) << (row & 63);
+    if (value) {
+        words_[row >> 6] |= bit;
+    } else {
+        words_[row >> 6] &= ~bit;
+    }
+}
+
+std::vector<uint32_t> Selection::rows() const {
+    std::vector<uint32_t> result;
+    result.reserve(count());
+    for (size_t w = 0; w < words_.size(); ++w) {
+        for (uint64_t bits = words_[w]; bits != 0; bits &= bits - 1) {
+            result.push_back(uint32_t(w * 64 + size_t(__builtin_ctzll(bits))));
+        }
+    }
+    return result;
+}
+
+Selection& Selection::operator&=(const Selection& other) {
+    for (size_t w = 0; w < words_.size(); ++w) {
+        words_[w] &= other.words_[w];
+    }
+    return *this;
+}
+
+Selection& Selection::operator|=(const Selection& other) {
+    for (size_t w = 0; w < words_.size(); ++w) {
+        words_[w] |= other.words_[w];
+    }
+    return *this;
+}
+
+Selection& Selection::flip() {
+    for (uint64_t& word : words_) {
+        word = ~word;
+    }
+    clearTail();
+    return *this;
+}
+
+void Selection::clearTail() {
+    if (size_ % 64 != 0) {
+        words_.back() &= (uint64_t(1) << (size_ % 64)) - 1;
+    }
+}
+
+Selection operator&(Selection a, const Selection& b) { return a &= b; }
+Selection operator|(Selection a, const Selection& b) { return a |= b; }
+Selection operator~(Selection a) { return a.flip(); }
+
+// Recursive-descent parser emitting steps in postfix order
+class SelectionParser {
+public:
+    using Step = Selector::Step;
+    using Field = Selector::Field;
+    using Compare = Selector::Compare;
+
+    SelectionParser(std::string_view text, std::vector<Step>& steps) : steps_(steps) {
+        tokenize(text);
+    }
+
+    bool parse(std::string* error) {
+        bool ok = error_.empty() && expression();
+        if (ok && peek().type != Token::End) {
+            ok = fail("unexpected '" + std::string(peek().text) + "'");
+        }
+        if (!ok && error) {
+            *error = error_;
+        }
+        return ok;
+    }
+
+private:
+    struct Token {
+        enum Type { Word, Open, Close, Operator, End };
+        Type type;
+        std::string_view text;
+    };
+
+    struct FieldName {
+        const char* name;
+        Field field;
+    };
+
+    static constexpr FieldName kFields[] = {
+        {"name", Field::Name}, {"resname", Field::ResName}, {"chain", Field::Chain},
+        {"element", Field::Element}, {"altloc", Field::AltLoc}, {"resseq", Field::ResSeq},
+        {"resid", Field::ResSeq}, {"serial", Field::Serial}, {"index", Field::Index},
+        {"x", Field::X}, {"y", Field::Y}, {"z", Field::Z}, {"occupancy", Field::Occupancy},
+        {"b", Field::TempFactor}, {"beta", Field::TempFactor},
+    };
+
+    static bool isOperatorChar(char ch) { return ch == '<' || ch == '>' || ch == '=' || ch == '!'; }
+
+    void tokenize(std::string_view text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char ch = text[i];
+            if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+                ++i;
+            } else if (ch == '(' || ch == ')') {
+                tokens_.push_back(Token{ch == '(' ? Token::Open : Token::Close, text.substr(i, 1)});
+                ++i;
+            } else if (isOperatorChar(ch)) {
+                size_t length = i + 1 < text.size() && text[i + 1] == '=' ? 2 : 1;
+                tokens_.push_back(Token{Token::Operator, text.substr(i, length)});
+                i += length;
+            } else if (ch == '"') {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string_view::npos) {
+                    fail("unterminated quote");
+                    return;
+                }
+                tokens_.push_back(Token{Token::Word, text.substr(i + 1, close - i - 1)});
+                i = close + 1;
+            } else {
+                size_t start = i;
+                while (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '\n' &&
+                       text[i] != '\r' && text[i] != '(' && text[i] != ')' && !isOperatorChar(text[i])) {
+                    ++i;
+                }
+                tokens_.push_back(Token{Token::Word, text.substr(start, i - start)});
+            }
+        }
+    }
+
+    const Token& peek() const {
+        static const Token end{Token::End, "end of selection"};
+        return next_ < tokens_.size() ? tokens_[next_] : end;
+    }
+    bool accept(std::string_view word) {
+        if (peek().type == Token::Word && peek().text == word) {
+            ++next_;
+            return true;
+        }
+        return false;
+    }
+    bool fail(const std::string& message) {
+        if (error_.empty()) {
+            error_ = message;
+        }
+        return false;
+    }
+
+    // Words that end a value list
+    bool isValue(const Token& token) const {
+        return token.type == Token::Word && token.text != "and" && token.text != "or";
+    }
+
+    bool expression() {
+        if (!term()) {
+            return false;
+        }
+        while (accept("or")) {
+            if (!term()) {
+                return false;
+            }
+            steps_.push_back(Step{Step::Kind::Or});
+        }
+        return true;
+    }
+
+    bool term() {
+        if (!factor()) {
+            return false;
+        }
+        while (accept("and")) {
+            if (!factor()) {
+                return false;
+            }
+            steps_.push_back(Step{Step::Kind::And});
+        }
+        return true;
+    }
+
+    bool factor() {
+        const Token token = peek();
+        if (token.type == Token::Open) {
+            ++next_;
+            if (!expression()) {
+                return false;
+            }
+            if (peek().type != Token::Close) {
+                return fail("expected ')'");
+            }
+            ++next_;
+            return true;
+        }
+        if (token.type != Token::Word) {
+            return fail("unexpected '" + std::string(token.text) + "'");
+        }
+        ++next_;
+
+        if (token.text == "not") {
+            if (!factor()) {
+                return false;
+            }
+            steps_.push_back(Step{Step::Kind::Not});
+            return true;
+        }
+        if (token.text == "within") {
+            Step step{Step::Kind::Within};
+            if (!number(step.value) || step.value < 0.0f) {
+                return fail("expected a distance after 'within'");
+            }
+            if (!accept("of")) {
+                return fail("expected 'of' after the distance");
+            }
+            if (!factor()) {
+                return false;
+            }
+            steps_.push_back(std::move(step));
+            return true;
+        }
+        if (token.text == "all" || token.text == "none") {
+            steps_.push_back(Step{token.text == "all" ? Step::Kind::All : Step::Kind::None});
+            return true;
+        }
+        if (token.text == "hetero") {
+            Step step{Step::Kind::Flag};
+            step.field = Field::Hetero;
+            steps_.push_back(std::move(step));
+            return true;
+        }
+        if (const char* text = macroText(token.text)) {
+            SelectionParser macro(text, steps_);
+            return macro.parse(nullptr);
+        }
+        for (const FieldName& entry : kFields) {
+            if (token.text == entry.name) {
+                return fieldClause(entry.field);
+            }
+        }
+        return fail("unknown keyword '" + std::string(token.text) + "'");
+    }
+
+    bool fieldClause(Field field) {
+        Step step{Step::Kind::Codes};
+        step.field = field;
+        if (field >= Field::X && field <= Field::TempFactor) {
+            step.kind = Step::Kind::Compare;
+            return compareClause(step);
+        }
+        if (field >= Field::ResSeq) {
+            step.kind = Step::Kind::Ranges;
+            if (peek().type == Token::Operator) {
+                return integerCompare(step);
+            }
+            while (isValue(peek())) {
+                std::pair<int, int> range;
+                if (!parseRange(peek().text, range)) {
+                    return fail("expected a number or range, got '" + std::string(peek().text) + "'");
+                }
+                ++next_;
+                if (accept("to")) {
+                    int last = 0;
+                    if (peek().type != Token::Word || decodeInt(peek().text, last) != ParseStatus::Ok) {
+                        return fail("expected a number after 'to'");
+                    }
+                    ++next_;
+                    range.second = last;
+                }
+                step.ranges.push_back(range);
+            }
+            if (step.ranges.empty()) {
+                return fail("expected values");
+            }
+            steps_.push_back(std::move(step));
+            return true;
+        }
+
+        // Codes: exact, or a prefix before '*'
+        while (isValue(peek())) {
+            std::string_view value = peek().text;
+            ++next_;
+            uint32_t mask = 0xffffffffu;
+            if (!value.empty() && value.back() == '*') {
+                value.remove_suffix(1);
+                size_t length = std::min<size_t>(value.size(), 4);
+                mask = length == 0 ? 0 : 0xffffffffu << (32 - 8 * length);
+            }
+            step.codes.emplace_back(Code(value).value() & mask, mask);
+        }
+        if (step.codes.empty()) {
+            return fail("expected values");
+        }
+        steps_.push_back(std::move(step));
+        return true;
+    }
+
+    bool comparison(Compare& out) {
+        static const std::pair<const char*, Compare> operators[] = {
+            {"<", Compare::Less}, {"<=", Compare::LessEqual}, {">", Compare::Greater},
+            {">=", Compare::GreaterEqual}, {"==", Compare::Equal}, {"=", Compare::Equal},
+            {"!=", Compare::NotEqual},
+        };
+        for (const auto& entry : operators) {
+            if (peek().type == Token::Operator && peek().text == entry.first) {
+                out = entry.second;
+                ++next_;
+                return true;
+            }
+        }
+        return fail("expected a comparison operator");
+    }
+
+    // Integer comparisons become ranges, e.g. "resseq < 20" is
+    // [INT_MIN, 19]
+    bool integerCompare(Step& step) {
+        const Token token = peek();
+        Compare compare = Compare::Equal;
+        int value = 0;
+        if (!comparison(compare)) {
+            return false;
+        }
+        if (peek().type != Token::Word || decodeInt(peek().text, value) != ParseStatus::Ok) {
+            return fail("expected an integer after '" + std::string(token.text) + "'");
+        }
+        ++next_;
+        const int64_t low = std::numeric_limits<int>::min();
+        const int64_t high = std::numeric_limits<int>::max();
+        auto add = [&step](int64_t first, int64_t last) {
+            if (first <= last) {
+                step.ranges.emplace_back(int(first), int(last));
+            }
+        };
+        switch (compare) {
+        case Compare::Less: add(low, int64_t(value) - 1); break;
+        case Compare::LessEqual: add(low, value); break;
+        case Compare::Greater: add(int64_t(value) + 1, high); break;
+        case Compare::GreaterEqual: add(value, high); break;
+        case Compare::Equal: add(value, value); break;
+        case Compare::NotEqual:
+            add(low, int64_t(value) - 1);
+            add(int64_t(value) + 1, high);
+            break;
+        }
+        steps_.push_back(std::move(step));
+        return true;
+    }
+
+    bool compareClause(Step& step) {
+        const Token token = peek();
+        if (!comparison(step.compare)) {
+            return false;
+        }
+        if (!number(step.value)) {
+            return fail("expected a number after '" + std::string(token.text) + "'");
+        }
+        steps_.push_back(std::move(step));
+        return true;
+    }
+
+    bool number(float& out) {
+        double value = 0.0;
+        if (peek().type != Token::Word || decodeFloat(peek().text, value) != ParseStatus::Ok) {
+            return false;
+        }
+        ++next_;
+        out = float(value);
+        return true;
+    }
+
+    // "N", "N-M" or "N:M"; the separator is searched after the first
+    // character so negative numbers work
+    static bool parseRange(std::string_view text, std::pair<int, int>& range) {
+        int first = 0;
+        if (decodeInt(text, first) == ParseStatus::Ok) {
+            range = {first, first};
+            return true;
+        }
+        size_t separator = text.find_first_of("-:", 1);
+        int last = 0;
+        if (separator == std::string_view::npos ||
+            decodeInt(text.substr(0, separator), first) != ParseStatus::Ok ||
+            decodeInt(text.substr(separator + 1), last) != ParseStatus::Ok) {
+            return false;
+        }
+        range = {first, last};
+        return true;
+    }
+
+    std::vector<Step>& steps_;
+    std::vector<Token> tokens_;
+    size_t next_{0};
+    std::string error_;
+};
+
+// Selector
+std::unique_ptr<Selector> Selector::compile(std::string_view text, std::string* error) {
+    std::unique_ptr<Selector> selector(new Selector());
+    selector->text_ = std::string(text);
+    SelectionParser parser(selector->text_, selector->steps_);
+    if (!parser.parse(error)) {
+        return nullptr;
+    }
+    return selector;
+}
+
+Selection Selector::select(const AtomTable& table, size_t maxThreads) const {
+    std::vector<Selection> stack;
+    for (const Step& step : steps_) {
+        switch (step.kind) {
+        case Step::Kind::And:
+        case Step::Kind::Or: {
+            Selection right = std::move(stack.back());
+            stack.pop_back();
+            if (step.kind == Step::Kind::And) {
+                stack.back() &= right;
+            } else {
+                stack.back() |= right;
+            }
+            break;
+        }
+        case Step::Kind::Not:
+            stack.back().flip();
+            break;
+        case Step::Kind::Within:
+            stack.back() = withinOf(table, stack.back(), step.value, maxThreads);
+            break;
+        default:
+            stack.push_back(evaluate(step, table, maxThreads));
+            break;
+        }
+    }
+    return stack.empty() ? Selection(table.size()) : std::move(stack.back());
+}
+
+Selection Selector::evaluate(const Step& step, const AtomTable& table, size_t maxThreads) const {
+    size_t size = table.size();
+    switch (step.kind) {
+    case Step::Kind::All:
+        return Selection(size, true);
+    case Step::Kind::Codes: {
+        auto matches = [&step](uint32_t value) {
+            for (const auto& code : step.codes) {
+                if ((value & code.second) == code.first) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        auto column = [&](const std::vector<Code>& codes) {
+            return fill(size, maxThreads, [&](size_t row) { return matches(codes[row].value()); });
+        };
+        switch (step.field) {
+        case Field::Name: return column(table.name);
+        case Field::ResName: return column(table.resName);
+        case Field::Chain: return column(table.chainID);
+        case Field::Element: return column(table.element);
+        default:
+            // altLoc is a char column; compare it as a one-character code
+            return fill(size, maxThreads, [&](size_t row) {
+                return matches(uint32_t(static_cast<unsigned char>(table.altLoc[row])) << 24);
+            });
+        }
+    }
+    case Step::Kind::Ranges: {
+        auto inRanges = [&step](int value) {
+            for (const auto& range : step.ranges) {
+                if (value >= range.first && value <= range.second) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        switch (step.field) {
+        case Field::ResSeq: return fill(size, maxThreads, [&](size_t row) { return inRanges(table.resSeq[row]); });
+        case Field::Serial: return fill(size, maxThreads, [&](size_t row) { return inRanges(table.serial[row]); });
+        default: return fill(size, maxThreads, [&](size_t row) { return inRanges(int(row)); });
+        }
+    }
+    case Step::Kind::Compare: {
+        const std::vector<float>* column = &table.tempFactor;
+        switch (step.field) {
+        case Field::X: column = &table.x; break;
+        case Field::Y: column = &table.y; break;
+        case Field::Z: column = &table.z; break;
+        case Field::Occupancy: column = &table.occupancy; break;
+        default: break;
+        }
+        const float* values = column->data();
+        float operand = step.value;
+        switch (step.compare) {
+        case Compare::Less: return fill(size, maxThreads, [=](size_t row) { return values[row] < operand; });
+        case Compare::LessEqual: return fill(size, maxThreads, [=](size_t row) { return values[row] <= operand; });
+        case Compare::Greater: return fill(size, maxThreads, [=](size_t row) { return values[row] > operand; });
+        case Compare::GreaterEqual: return fill(size, maxThreads, [=](size_t row) { return values[row] >= operand; });
+        case Compare::Equal: return fill(size, maxThreads, [=](size_t row) { return values[row] == operand; });
+        case Compare::NotEqual: return fill(size, maxThreads, [=](size_t row) { return values[row] != operand; });
+        }
+        break;
+    }
+    case Step::Kind::Flag:
+        return fill(size, maxThreads, [&](size_t row) { return table.hetero[row] != 0; });
+    default:
+        break;
+    }
+    return Selection(size);
+}
+
+Selection select(const AtomTable& table, std::string_view text) {
+    std::unique_ptr<Selector> selector = Selector::compile(text);
+    return selector ? selector->select(table) : Selection();
+}
+
+} // namespace pdb
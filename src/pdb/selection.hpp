@@ -0,0 +1,114 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace pdb {
+
+class AtomTable;
+
+// Bitmask over atom rows in Model order (atoms, then hetAtoms), one bit per
+// row packed 64 to a word
+class Selection {
+public:
+    // Constructors
+    Selection() = default;
+    explicit Selection(size_t size, bool value = false);
+
+    size_t size() const { return size_; }
+    size_t count() const;
+    bool any() const;
+    bool test(size_t row) const { return (words_[row >> 6] >> (row & 63)) & 1; }
+    void set(size_t row, bool value = true);
+
+    // Selected rows in ascending order
+    std::vector<uint32_t> rows() const;
+
+    // Set algebra; both sides must have the same size
+    Selection& operator&=(const Selection& other);
+    Selection& operator|=(const Selection& other);
+    Selection& flip();
+
+    // Raw words; bits past size() are always zero
+    std::vector<uint64_t>& words() { return words_; }
+    const std::vector<uint64_t>& words() const { return words_; }
+
+private:
+    void clearTail();
+
+    std::vector<uint64_t> words_;
+    size_t size_{0};
+};
+
+Selection operator&(Selection a, const Selection& b);
+Selection operator|(Selection a, const Selection& b);
+Selection operator~(Selection a);
+
+// Atom selection expression compiled to a postfix plan. Each leaf fills a
+// whole bitmask from one AtomTable column in a tight loop, and and/or/not
+// combine masks a word at a time. Grammar, with lowercase keywords:
+//
+//   expr    := term ("or" term)*
+//   term    := factor ("and" factor)*
+//   factor  := "not" factor | "(" expr ")" | "within" R "of" factor
+//            | "all" | "none" | "hetero" | "protein" | "backbone"
+//            | "sidechain" | "water" | "hydrogen"
+//            | name|resname|chain|element|altloc VALUE...
+//            | resseq|resid|serial|index RANGE...
+//            | resseq|resid|serial|index|x|y|z|occupancy|b OP NUMBER
+//
+// where OP is one of < <= > >= == !=
+//
+// Code values match exactly or, with a trailing '*', by prefix ("C*").
+// Ranges are single integers, "10-80", "10:80" or "10 to 80". "within R of
+// S" selects atoms at most R angstroms from any atom of S, S included,
+// using a CellGrid over S. Examples: "chain A and resseq 10-80 and
+// backbone", "within 5 of resname LIG and not water".
+class Selector {
+public:
+    // Returns nullptr on a syntax error, describing it in error if given
+    static std::unique_ptr<Selector> compile(std::string_view text, std::string* error = nullptr);
+
+    // Evaluates the plan over table, splitting large tables across up to
+    // maxThreads threads (0: one per core)
+    Selection select(const AtomTable& table, size_t maxThreads = 0) const;
+
+    const std::string& text() const { return text_; }
+
+private:
+    friend class SelectionParser;
+
+    enum class Field : uint8_t {
+        Name, ResName, Chain, Element, AltLoc,  // Codes
+        ResSeq, Serial, Index,                  // Integers
+        X, Y, Z, Occupancy, TempFactor,         // Floats
+        Hetero
+    };
+    enum class Compare : uint8_t { Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+
+    // One plan step. Leaves push a mask; And and Or pop two and push one;
+    // Not and Within replace the top mask.
+    struct Step {
+        enum class Kind : uint8_t { All, None, Codes, Ranges, Compare, Flag, And, Or, Not, Within };
+
+        explicit Step(Kind kind) : kind(kind) {}
+
+        Kind kind;
+        Field field{Field::Name};
+        Compare compare{Compare::Equal};
+        float value{0.0f};  // Compare operand or Within radius
+        std::vector<std::pair<uint32_t, uint32_t>> codes;  // (value, mask) of each pattern
+        std::vector<std::pair<int, int>> ranges;           // Inclusive
+    };
+
+    Selector() = default;
+    Selection evaluate(const Step& step, const AtomTable& table, size_t maxThreads) const;
+
+    std::vector<Step> steps_;
+    std::string text_;
+};
+
+// Compiles and evaluates text in one go; returns an empty Selection (size
+// 0) on a syntax error
+Selection select(const AtomTable& table, std::string_view text);
+
+} // namespace pdb
@@ -0,0 +1,308 @@
+#include "pdb/spatial.hpp"
+#include "pdb/atom_table.hpp"
+#include "pdb/model.hpp"
+#include <cmath>
+
+namespace pdb {
+
+namespace {
+
+// Most cells along one axis; larger boxes get larger cells
+constexpr float kMaxCellsPerAxis = float(1 << 20);
+
+// Hit order for nearest(): by distance, ties by row
+bool closer(const Neighbor& a, const Neighbor& b) {
+    return a.distance2 < b.distance2 || (a.distance2 == b.distance2 && a.row < b.row);
+}
+
+void appendNearest(std::vector<Neighbor>& candidates, size_t k, std::vector<Neighbor>& hits) {
+    k = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), closer);
+    hits.insert(hits.end(), candidates.begin(), candidates.begin() + k);
+}
+
+} // namespace
+
+std::vector<Point> positionsOf(const AtomTable& table) {
+    std::vector<Point> points(table.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        points[i] = Point{table.x[i], table.y[i], table.z[i]};
+    }
+    return points;
+}
+
+std::vector<Point> positionsOf(const Model& model) {
+    std::vector<Point> points;
+    points.reserve(model.atoms.size() + model.hetAtoms.size());
+    for (const auto* atoms : {&model.atoms, &model.hetAtoms}) {
+        for (const auto& atom : *atoms) {
+            points.push_back(Point{float(atom->x), float(atom->y), float(atom->z)});
+        }
+    }
+    return points;
+}
+
+CellGrid::CellGrid(std::vector<Point> points, float cellSize)
+    : cellSize_(cellSize > 0.0f ? cellSize : 1.0f) {
+    size_t count = points.size();
+    if (count == 0) {
+        start_.assign(2, 0);
+        return;
+    }
+
+    float high[3] = {points[0].x, points[0].y, points[0].z};
+    std::copy(high, high + 3, low_);
+    for (const Point& p : points) {
+        const float v[3] = {p.x, p.y, p.z};
+        for (int d = 0; d < 3; ++d) {
+            low_[d] = std::min(low_[d], v[d]);
+            high[d] = std::max(high[d], v[d]);
+        }
+    }
+    for (int d = 0; d < 3; ++d) {
+        cellSize_ = std::max(cellSize_, (high[d] - low_[d]) / kMaxCellsPerAxis);
+    }
+    for (int d = 0; d < 3; ++d) {
+        dims_[d] = int32_t((high[d] - low_[d]) / cellSize_) + 1;
+    }
+
+    uint64_t cells = uint64_t(dims_[0]) * uint64_t(dims_[1]) * uint64_t(dims_[2]);
+    dense_ = cells <= 2 * uint64_t(count);
+    size_t buckets = 1;
+    while (buckets < count) {
+        buckets *= 2;
+    }
+    if (dense_) {
+        buckets = size_t(cells);
+    }
+    mask_ = buckets - 1;
+
+    // Counting sort by bucket
+    std::vector<Entry> unsorted(count);
+    start_.assign(buckets + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const Point& p = points[i];
+        uint64_t key = keyOf(cellOf(p.x, 0), cellOf(p.y, 1), cellOf(p.z, 2));
+        unsorted[i] = Entry{p.x, p.y, p.z, uint32_t(i), key};
+        ++start_[bucketOf(key) + 1];
+    }
+    points.clear();
+    points.shrink_to_fit();
+    for (size_t b = 0; b < buckets; ++b) {
+        start_[b + 1] += start_[b];
+    }
+    entries_.resize(count);
+    std::vector<uint32_t> cursor(start_.begin(), start_.end() - 1);
+    for (const Entry& entry : unsorted) {
+        entries_[cursor[bucketOf(entry.key)]++] = entry;
+    }
+}
+
+int32_t CellGrid::cellOf(float value, int axis) const {
+    int32_t cell = int32_t((value - low_[axis]) / cellSize_);
+    return std::min(std::max(cell, 0), dims_[axis] - 1);
+}
+
+void CellGrid::within(const Point& p, float radius, std::vector<Neighbor>& hits) const {
+    if (entries_.empty() || radius < 0.0f) {
+        return;
+    }
+    float radius2 = radius * radius;
+    auto test = [&](uint32_t j) {
+        const Entry& e = entries_[j];
+        float dx = p.x - e.x, dy = p.y - e.y, dz = p.z - e.z;
+        float d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 <= radius2) {
+            hits.push_back(Neighbor{e.row, d2});
+        }
+    };
+
+    // Cell range of the query box, clipped to the grid
+    const float v[3] = {p.x, p.y, p.z};
+    int32_t first[3], last[3];
+    uint64_t cells = 1;
+    for (int d = 0; d < 3; ++d) {
+        float lo = std::floor((v[d] - radius - low_[d]) / cellSize_);
+        float hi = std::floor((v[d] + radius - low_[d]) / cellSize_);
+        if (hi < 0.0f || lo >= float(dims_[d])) {
+            return;
+        }
+        first[d] = int32_t(std::max(lo, 0.0f));
+        last[d] = int32_t(std::min(hi, float(dims_[d] - 1)));
+        cells *= uint64_t(last[d] - first[d] + 1);
+    }
+
+    // A query box with more cells than points is cheaper as a plain scan
+    if (cells > entries_.size()) {
+        for (uint32_t j = 0; j < entries_.size(); ++j) {
+            test(j);
+        }
+        return;
+    }
+    for (int32_t cz = first[2]; cz <= last[2]; ++cz) {
+        for (int32_t cy = first[1]; cy <= last[1]; ++cy) {
+            forEachInRow(first[0], last[0], cy, cz, test);
+        }
+    }
+}
+
+void CellGrid::nearest(const Point& p, size_t k, std::vector<Neighbor>& hits) const {
+    if (k == 0 || entries_.empty()) {
+        return;
+    }
+
+    // Grow the radius from the distance to the grid until k points fall
+    // inside it; the k nearest are then among them
+    const float v[3] = {p.x, p.y, p.z};
+    float outside2 = 0.0f;
+    for (int d = 0; d < 3; ++d) {
+        float high = low_[d] + float(dims_[d]) * cellSize_;
+        float gap = std::max({low_[d] - v[d], v[d] - high, 0.0f});
+        outside2 += gap * gap;
+    }
+    float radius = std::sqrt(outside2) + cellSize_;
+    std::vector<Neighbor> candidates;
+    while (true) {
+        candidates.clear();
+        within(p, radius, candidates);
+        if (candidates.size() >= std::min(k, entries_.size())) {
+            break;
+        }
+        radius *= 2.0f;
+    }
+    appendNearest(candidates, k, hits);
+}
+
+KdTree::KdTree(std::vector<Point> points) {
+    entries_.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        entries_[i] = Entry{{points[i].x, points[i].y, points[i].z}, uint32_t(i)};
+    }
+    points.clear();
+    points.shrink_to_fit();
+    if (!entries_.empty()) {
+        nodes_.reserve(4 * entries_.size() / kLeafSize + 1);
+        build(0, uint32_t(entries_.size()));
+    }
+}
+
+uint32_t KdTree::build(uint32_t begin, uint32_t end) {
+    uint32_t index = uint32_t(nodes_.size());
+    nodes_.push_back(Node{begin, end, kLeaf, 0.0f, 0});
+    if (end - begin <= kLeafSize) {
+        return index;
+    }
+
+    // Split at the median of the widest axis
+    float low[3] = {entries_[begin].p[0], entries_[begin].p[1], entries_[begin].p[2]};
+    float high[3] = {low[0], low[1], low[2]};
+    for (uint32_t i = begin; i < end; ++i) {
+        for (int d = 0; d < 3; ++d) {
+            low[d] = std::min(low[d], entries_[i].p[d]);
+            high[d] = std::max(high[d], entries_[i].p[d]);
+        }
+    }
+    uint8_t axis = 0;
+    for (uint8_t d = 1; d < 3; ++d) {
+        if (high[d] - low[d] > high[axis] - low[axis]) {
+            axis = d;
+        }
+    }
+    uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(entries_.begin() + begin, entries_.begin() + middle, entries_.begin() + end,
+                     [axis](const Entry& a, const Entry& b) { return a.p[axis] < b.p[axis]; });
+
+    nodes_[index].split = entries_[middle].p[axis];
+    nodes_[index].axis = axis;
+    build(begin, middle);
+    nodes_[index].right = build(middle, end);
+    return index;
+}
+
+void KdTree::within(const Point& p, float radius, std::vector<Neighbor>& hits) const {
+    if (nodes_.empty() || radius < 0.0f) {
+        return;
+    }
+    const float v[3] = {p.x, p.y, p.z};
+    float radius2 = radius * radius;
+
+    // Depth is at most log2(size()), so a fixed stack is enough
+    uint32_t stack[64];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes_[index];
+        if (node.right == kLeaf) {
+            for (uint32_t i = node.begin; i < node.end; ++i) {
+                const Entry& e = entries_[i];
+                float dx = v[0] - e.p[0], dy = v[1] - e.p[1], dz = v[2] - e.p[2];
+                float d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 <= radius2) {
+                    hits.push_back(Neighbor{e.row, d2});
+                }
+            }
+            continue;
+        }
+        float delta = v[node.axis] - node.split;
+        if (delta <= radius) {
+            stack[top++] = index + 1;
+        }
+        if (delta >= -radius) {
+            stack[top++] = node.right;
+        }
+    }
+}
+
+void KdTree::nearest(const Point& p, size_t k, std::vector<Neighbor>& hits) const {
+    if (k == 0 || nodes_.empty()) {
+        return;
+    }
+    const float v[3] = {p.x, p.y, p.z};
+
+    // Max-heap of the best k so far. Nodes are visited nearer side first,
+    // each with a lower bound on its distance, and skipped once the bound
+    // exceeds the current k-th distance.
+    struct Pending {
+        uint32_t node;
+        float bound;
+    };
+    Pending stack[64];
+    size_t top = 0;
+    stack[top++] = Pending{0, 0.0f};
+    std::vector<Neighbor> heap;
+    heap.reserve(std::min(k, entries_.size()));
+    while (top > 0) {
+        Pending pending = stack[--top];
+        if (heap.size() == k && pending.bound > heap.front().distance2) {
+            continue;
+        }
+        const Node& node = nodes_[pending.node];
+        if (node.right == kLeaf) {
+            for (uint32_t i = node.begin; i < node.end; ++i) {
+                const Entry& e = entries_[i];
+                float dx = v[0] - e.p[0], dy = v[1] - e.p[1], dz = v[2] - e.p[2];
+                Neighbor hit{e.row, dx * dx + dy * dy + dz * dz};
+                if (heap.size() < k) {
+                    heap.push_back(hit);
+                    std::push_heap(heap.begin(), heap.end(), closer);
+                } else if (closer(hit, heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), closer);
+                    heap.back() = hit;
+                    std::push_heap(heap.begin(), heap.end(), closer);
+                }
+            }
+            continue;
+        }
+        float delta = v[node.axis] - node.split;
+        uint32_t left = pending.node + 1;
+        uint32_t nearer = delta <= 0.0f ? left : node.right;
+        uint32_t farther = delta <= 0.0f ? node.right : left;
+        stack[top++] = Pending{farther, std::max(pending.bound, delta * delta)};
+        stack[top++] = Pending{nearer, pending.bound};
+    }
+    std::sort_heap(heap.begin(), heap.end(), closer);
+    hits.insert(hits.end(), heap.begin(), heap.end());
+}
+
+} // namespace pdb
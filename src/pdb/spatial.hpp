@@ -0,0 +1,307 @@
+#pragma once
+
+#include "common.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+
+namespace pdb {
+
+class AtomTable;
+class Model;
+
+struct Point {
+    float x{0.0f}, y{0.0f}, z{0.0f};
+};
+
+// Query hit: row of the point in the indexed set and its squared distance
+struct Neighbor {
+    uint32_t row;
+    float distance2;
+};
+
+// Batch query results as compressed sparse rows: the hits of query i are
+// hits[offsets[i], offsets[i + 1])
+struct NeighborLists {
+    std::vector<uint32_t> offsets;
+    std::vector<Neighbor> hits;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+// Atom positions by row in Model order (atoms, then hetAtoms), which is
+// also the row order of an AtomTable built from the model
+std::vector<Point> positionsOf(const AtomTable& table);
+std::vector<Point> positionsOf(const Model& model);
+
+// Uniform cell list. Points are counting-sorted by cell, with cell keys
+// that are linear indices over the bounding box, so the cells of one x row
+// sit next to each other. A sparse box with more than twice as many cells
+// as points is folded into a power-of-two bucket table; entries keep their
+// cell key so colliding cells are told apart. Best for many queries with a
+// radius close to the cell size.
+class CellGrid {
+public:
+    // Constructors
+    CellGrid() = default;
+    CellGrid(std::vector<Point> points, float cellSize);
+    CellGrid(const AtomTable& table, float cellSize) : CellGrid(positionsOf(table), cellSize) {}
+    CellGrid(const Model& model, float cellSize) : CellGrid(positionsOf(model), cellSize) {}
+
+    size_t size() const { return entries_.size(); }
+    float cellSize() const { return cellSize_; }
+
+    // Appends the points within radius of p, in no particular order
+    void within(const Point& p, float radius, std::vector<Neighbor>& hits) const;
+    // Appends the k points nearest to p (fewer if the grid is smaller),
+    // closest first
+    void nearest(const Point& p, size_t k, std::vector<Neighbor>& hits) const;
+
+    std::vector<Neighbor> within(const Point& p, float radius) const {
+        std::vector<Neighbor> hits;
+        within(p, radius, hits);
+        return hits;
+    }
+    std::vector<Neighbor> nearest(const Point& p, size_t k) const {
+        std::vector<Neighbor> hits;
+        nearest(p, k, hits);
+        return hits;
+    }
+
+    // Row of the point in grid slot i. Points are stored in cell order;
+    // per-point data gathered into slot order is read sequentially by
+    // pairsWithin.
+    uint32_t rowAt(size_t slot) const { return entries_[slot].row; }
+
+    // Every pair of points at most cutoff apart (cutoff is capped at
+    // cellSize()) for which keep(slotA, slotB, distance2) returns true, as
+    // rows, once each with the lower row first. Each point is tested
+    // against the half shell of cells after it, split across threads, so
+    // keep must be safe to call concurrently. Pairs come back in a fixed
+    // order.
+    template <typename Keep>
+    std::vector<std::pair<uint32_t, uint32_t>> pairsWithin(float cutoff, Keep&& keep,
+                                                           size_t maxThreads = 0) const;
+
+private:
+    static constexpr size_t kPairBlock = 16384;
+
+    struct Entry {
+        float x, y, z;
+        uint32_t row;
+        uint64_t key;  // Linear cell index, see keyOf()
+    };
+
+    int32_t cellOf(float value, int axis) const;
+    uint64_t keyOf(int32_t cx, int32_t cy, int32_t cz) const {
+        return uint64_t(cx) + uint64_t(dims_[0]) * (uint64_t(cy) + uint64_t(dims_[1]) * uint64_t(cz));
+    }
+    size_t bucketOf(uint64_t key) const { return dense_ ? size_t(key) : size_t(key & mask_); }
+
+    // Calls fn(entry index) for the points of cells [x0, x1] of one x row,
+    // or of entries [first, ...) of that row when first is given
+    template <typename Fn>
+    void forEachInRow(int32_t x0, int32_t x1, int32_t cy, int32_t cz, Fn&& fn,
+                      uint32_t first = 0) const;
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> start_;  // Bucket b holds entries_[start_[b], start_[b + 1])
+    float low_[3]{};
+    int32_t dims_[3]{1, 1, 1};
+    float cellSize_{1.0f};
+    bool dense_{true};
+    size_t mask_{0};
+};
+
+// Balanced k-d tree over a point set, split at the median of the widest
+// axis down to small leaves. Unlike CellGrid it needs no cell size, so it
+// suits queries whose radius varies widely and nearest-neighbour searches
+// over sparse or clustered points.
+class KdTree {
+public:
+    // Constructors
+    KdTree() = default;
+    explicit KdTree(std::vector<Point> points);
+    explicit KdTree(const AtomTable& table) : KdTree(positionsOf(table)) {}
+    explicit KdTree(const Model& model) : KdTree(positionsOf(model)) {}
+
+    size_t size() const { return entries_.size(); }
+
+    // Same queries as CellGrid
+    void within(const Point& p, float radius, std::vector<Neighbor>& hits) const;
+    void nearest(const Point& p, size_t k, std::vector<Neighbor>& hits) const;
+
+    std::vector<Neighbor> within(const Point& p, float radius) const {
+        std::vector<Neighbor> hits;
+        within(p, radius, hits);
+        return hits;
+    }
+    std::vector<Neighbor> nearest(const Point& p, size_t k) const {
+        std::vector<Neighbor> hits;
+        nearest(p, k, hits);
+        return hits;
+    }
+
+private:
+    static constexpr uint32_t kLeafSize = 8;
+    static constexpr uint32_t kLeaf = 0xffffffffu;
+
+    struct Entry {
+        float p[3];
+        uint32_t row;
+    };
+
+    // Inner nodes split entries_[begin, end) at split along axis; the left
+    // child is the next node, right the node at index right
+    struct Node {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t right;  // kLeaf for leaves
+        float split;
+        uint8_t axis;
+    };
+
+    uint32_t build(uint32_t begin, uint32_t end);
+
+    std::vector<Entry> entries_;
+    std::vector<Node> nodes_;
+};
+
+// Runs within() for every query, across threads unless maxThreads is 1
+template <typename Index>
+NeighborLists withinBatch(const Index& index, const std::vector<Point>& queries, float radius,
+                          size_t maxThreads = 0);
+
+// Runs nearest() for every query, across threads unless maxThreads is 1
+template <typename Index>
+NeighborLists nearestBatch(const Index& index, const std::vector<Point>& queries, size_t k,
+                           size_t maxThreads = 0);
+
+// CellGrid templates
+template <typename Fn>
+void CellGrid::forEachInRow(int32_t x0, int32_t x1, int32_t cy, int32_t cz, Fn&& fn,
+                            uint32_t first) const {
+    if (dense_) {
+        // The row is one run of buckets
+        uint64_t key = keyOf(x0, cy, cz);
+        uint32_t last = start_[key + uint64_t(x1 - x0) + 1];
+        for (uint32_t j = std::max(first, start_[key]); j < last; ++j) {
+            fn(j);
+        }
+        return;
+    }
+    for (int32_t cx = x0; cx <= x1; ++cx) {
+        uint64_t key = keyOf(cx, cy, cz);
+        size_t bucket = bucketOf(key);
+        for (uint32_t j = std::max(first, start_[bucket]); j < start_[bucket + 1]; ++j) {
+            if (entries_[j].key == key) {
+                fn(j);
+            }
+        }
+    }
+}
+
+template <typename Keep>
+std::vector<std::pair<uint32_t, uint32_t>> CellGrid::pairsWithin(float cutoff, Keep&& keep,
+                                                                 size_t maxThreads) const {
+    using Pair = std::pair<uint32_t, uint32_t>;
+    float limit = std::min(cutoff, cellSize_);
+    float limit2 = limit * limit;
+    size_t count = entries_.size();
+    size_t blocks = (count + kPairBlock - 1) / kPairBlock;
+    std::vector<std::vector<Pair>> found(blocks);
+
+    parallel_for(blocks, [&](size_t block) {
+        std::vector<Pair>& pairs = found[block];
+        size_t end = std::min(count, (block + 1) * kPairBlock);
+        for (size_t i = block * kPairBlock; i < end; ++i) {
+            const Entry& a = entries_[i];
+            auto test = [&](uint32_t j) {
+                const Entry& b = entries_[j];
+                float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+                float d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 <= limit2 && keep(uint32_t(i), j, d2)) {
+                    pairs.emplace_back(std::min(a.row, b.row), std::max(a.row, b.row));
+                }
+            };
+
+            // Own cell after this entry, the next cell of the row, then
+            // the rows after this one in key order
+            int32_t cx = int32_t(a.key % uint64_t(dims_[0]));
+            int32_t cy = int32_t(a.key / uint64_t(dims_[0]) % uint64_t(dims_[1]));
+            int32_t cz = int32_t(a.key / (uint64_t(dims_[0]) * uint64_t(dims_[1])));
+            int32_t x0 = std::max(cx - 1, 0);
+            int32_t x1 = std::min(cx + 1, dims_[0] - 1);
+            forEachInRow(cx, cx, cy, cz, test, uint32_t(i + 1));
+            if (cx + 1 <= x1) {
+                forEachInRow(cx + 1, x1, cy, cz, test);
+            }
+            for (int32_t z = cz; z <= std::min(cz + 1, dims_[2] - 1); ++z) {
+                for (int32_t y = z == cz ? cy + 1 : std::max(cy - 1, 0); y <= std::min(cy + 1, dims_[1] - 1); ++y) {
+                    forEachInRow(x0, x1, y, z, test);
+                }
+            }
+        }
+    }, maxThreads);
+
+    size_t total = 0;
+    for (const auto& part : found) {
+        total += part.size();
+    }
+    std::vector<Pair> pairs;
+    pairs.reserve(total);
+    for (const auto& part : found) {
+        pairs.insert(pairs.end(), part.begin(), part.end());
+    }
+    return pairs;
+}
+
+// Batch query templates
+namespace detail {
+
+constexpr size_t kQueryBlock = 1024;
+
+template <typename Query>
+NeighborLists batchQuery(size_t count, Query&& query, size_t maxThreads) {
+    size_t blocks = (count + kQueryBlock - 1) / kQueryBlock;
+    std::vector<std::vector<Neighbor>> hits(blocks);
+    std::vector<uint32_t> counts(count);
+    parallel_for(blocks, [&](size_t block) {
+        size_t end = std::min(count, (block + 1) * kQueryBlock);
+        for (size_t i = block * kQueryBlock; i < end; ++i) {
+            size_t before = hits[block].size();
+            query(i, hits[block]);
+            counts[i] = uint32_t(hits[block].size() - before);
+        }
+    }, maxThreads);
+
+    NeighborLists lists;
+    lists.offsets.resize(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        lists.offsets[i + 1] = lists.offsets[i] + counts[i];
+    }
+    lists.hits.reserve(lists.offsets[count]);
+    for (const auto& part : hits) {
+        lists.hits.insert(lists.hits.end(), part.begin(), part.end());
+    }
+    return lists;
+}
+
+} // namespace detail
+
+template <typename Index>
+NeighborLists withinBatch(const Index& index, const std::vector<Point>& queries, float radius,
+                          size_t maxThreads) {
+    return detail::batchQuery(queries.size(), [&](size_t i, std::vector<Neighbor>& hits) {
+        index.within(queries[i], radius, hits);
+    }, maxThreads);
+}
+
+template <typename Index>
+NeighborLists nearestBatch(const Index& index, const std::vector<Point>& queries, size_t k,
+                           size_t maxThreads) {
+    return detail::batchQuery(queries.size(), [&](size_t i, std::vector<Neighbor>& hits) {
+        index.nearest(queries[i], k, hits);
+    }, maxThreads);
+}
+
+} // namespace pdb
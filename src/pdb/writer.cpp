@@ -0,0 +1,363 @@
+#include "pdb/writer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace pdb {
+
+namespace {
+
+constexpr double kScale[] = {1.0, 10.0, 100.0, 1000.0};
+
+// Items of the _atom_site loop, in row order
+constexpr const char* kCifItems[] = {
+    "group_PDB", "id", "type_symbol", "label_atom_id", "label_alt_id", "label_comp_id",
+    "label_asym_id", "label_seq_id", "pdbx_PDB_ins_code", "Cartn_x", "Cartn_y", "Cartn_z",
+    "occupancy", "B_iso_or_equiv", "pdbx_formal_charge", "auth_seq_id", "auth_comp_id",
+    "auth_asym_id", "auth_atom_id", "pdbx_PDB_model_num"
+};
+
+// Characters of a Code without allocating
+struct CodeText {
+    explicit CodeText(Code code) : size(code.size()) {
+        for (size_t i = 0; i < size; ++i) {
+            chars[i] = code[i];
+        }
+    }
+
+    std::string_view view() const { return std::string_view(chars, size); }
+
+    char chars[4];
+    size_t size;
+};
+
+// value with precision decimals, formatted as an integer with the point
+// inserted, which is much faster than floating-point conversion
+char* formatFixed(char* out, double value, int precision) {
+    if (!std::isfinite(value)) {
+        value = 0.0;
+    }
+    double scaled = std::round(std::fabs(value) * kScale[precision]);
+    uint64_t units = uint64_t(std::min(scaled, 1e18));
+    uint64_t scale = uint64_t(kScale[precision]);
+    if (value < 0.0 && units != 0) {
+        *out++ = '-';
+    }
+    out = std::to_chars(out, out + 20, units / scale).ptr;
+    if (precision > 0) {
+        uint64_t fraction = units % scale;
+        *out = '.';
+        for (int i = precision; i > 0; --i) {
+            out[i] = char('0' + fraction % 10);
+            fraction /= 10;
+        }
+        out += precision + 1;
+    }
+    return out;
+}
+
+// Right-aligned in field[0, width); drops decimals and then clamps to fit
+void putFixed(char* field, int width, double value, int precision) {
+    char text[32];
+    for (int p = precision; p >= 0; --p) {
+        size_t length = size_t(formatFixed(text, value, p) - text);
+        if (length <= size_t(width)) {
+            std::fill(field, field + width - length, ' ');
+            std::memcpy(field + width - length, text, length);
+            return;
+        }
+    }
+    double limit = std::pow(10.0, value < 0.0 ? width - 1 : width) - 1.0;
+    putFixed(field, width, value < 0.0 ? -limit : limit, 0);
+}
+
+void putLeft(char* field, size_t width, std::string_view text) {
+    std::memcpy(field, text.data(), std::min(width, text.size()));
+}
+
+void putRight(char* field, size_t width, std::string_view text) {
+    size_t length = std::min(width, text.size());
+    std::memcpy(field + width - length, text.data(), length);
+}
+
+void putHybrid36(char* field, int width, int value) {
+    if (!encodeHybrid36(value, width, field)) {
+        std::fill(field, field + width, '*');
+    }
+}
+
+// PDB atom names start in column 14 unless they fill all four columns or
+// have a two-letter element, e.g. " CA " (carbon) but "CA  " (calcium)
+void putAtomName(char* field, const Atom& atom) {
+    CodeText name(atom.name);
+    bool shift = name.size < 4 && atom.element.size() < 2;
+    putLeft(field + (shift ? 1 : 0), shift ? 3 : 4, name.view());
+}
+
+// mmCIF value, quoted when it would otherwise read as something else
+void appendCifValue(std::string& out, std::string_view value, char missing) {
+    if (value.empty()) {
+        out += missing;
+        return;
+    }
+    bool quote = value[0] == '_' || value[0] == '#' || value[0] == '$' || value[0] == '\'' ||
+                 value[0] == '"' || value[0] == ';' || value[0] == '[' || value[0] == ']' ||
+                 value == "." || value == "?" ||
+                 value.find_first_of(" \t") != std::string_view::npos;
+    if (!quote) {
+        out += value;
+        return;
+    }
+    char mark = value.find('\'') == std::string_view::npos ? '\'' : '"';
+    out += mark;
+    out += value;
+    out += mark;
+}
+
+void appendCifInt(std::string& out, int value) {
+    char text[16];
+    out.append(text, std::to_chars(text, text + sizeof(text), value).ptr);
+}
+
+void appendCifFixed(std::string& out, double value, int precision) {
+    char text[32];
+    out.append(text, formatFixed(text, value, precision));
+}
+
+// mmCIF pdbx_formal_charge from PDB-style "2+" or "1-"
+void appendCifCharge(std::string& out, Code charge) {
+    if (charge.size() != 2 || charge[0] < '0' || charge[0] > '9' ||
+        (charge[1] != '+' && charge[1] != '-')) {
+        out += '?';
+        return;
+    }
+    if (charge[1] == '-' && charge[0] != '0') {
+        out += '-';
+    }
+    out += charge[0];
+}
+
+} // namespace
+
+Writer::Writer(const std::string& path)
+    : Writer(path, [&path] {
+          std::string ext = std::filesystem::path(path).extension().string();
+          std::transform(ext.begin(), ext.end(), ext.begin(),
+                         [](unsigned char c) { return char(std::tolower(c)); });
+          return ext == ".cif" || ext == ".mmcif" ? WriteFormat::Cif : WriteFormat::Pdb;
+      }()) {}
+
+Writer::Writer(const std::string& path, WriteFormat format)
+    : path_(path), format_(format), out_(path, std::ios::binary | std::ios::trunc) {
+    buffer_.reserve(kFlushBytes + (size_t(64) << 10));
+}
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::write(const Model& model) {
+    return writeRows(model, [&model](size_t row) -> const Atom& {
+        return row < model.atoms.size() ? *model.atoms[row]
+                                        : *model.hetAtoms[row - model.atoms.size()];
+    }, false);
+}
+
+bool Writer::write(const Model& model, const std::vector<Point>& coordinates) {
+    if (coordinates.size() != model.atoms.size() + model.hetAtoms.size()) {
+        return false;
+    }
+    return writeRows(model, [&coordinates](size_t row) -> const Point& { return coordinates[row]; }, true);
+}
+
+void Writer::clearCache() {
+    cached_ = nullptr;
+    cachedRows_ = 0;
+    fixed_.clear();
+    offsets_.clear();
+}
+
+template <typename Position>
+bool Writer::writeRows(const Model& model, const Position& position, bool frame) {
+    if (closed_ || !is_open()) {
+        return false;
+    }
+    size_t rows = model.atoms.size() + model.hetAtoms.size();
+    if (!frame || cached_ != &model || cachedRows_ != rows) {
+        prepare(model);
+    }
+    ++models_;
+
+    char number[16];
+    size_t numberLength = size_t(std::to_chars(number, number + sizeof(number), models_).ptr - number);
+    if (format_ == WriteFormat::Pdb) {
+        // "MODEL" with the serial in columns 11-14
+        buffer_ += "MODEL     ";
+        buffer_.append(std::max<size_t>(numberLength, 4) - numberLength, ' ');
+        buffer_.append(number, numberLength);
+        buffer_ += '\n';
+    } else if (models_ == 1) {
+        std::string name = std::filesystem::path(path_).stem().string();
+        std::replace_if(name.begin(), name.end(), [](unsigned char c) { return std::isspace(c); }, '_');
+        buffer_ += "data_";
+        buffer_ += name.empty() ? "foldgl" : name;
+        buffer_ += "\n#\nloop_\n";
+        for (const char* item : kCifItems) {
+            buffer_ += "_atom_site.";
+            buffer_ += item;
+            buffer_ += '\n';
+        }
+    }
+
+    const char* fixed = fixed_.data();
+    for (size_t row = 0; row < rows; ++row) {
+        const auto& p = position(row);
+        buffer_.append(fixed + offsets_[2 * row], fixed + offsets_[2 * row + 1]);
+        if (format_ == WriteFormat::Pdb) {
+            char coordinates[24];
+            putFixed(coordinates, 8, p.x, 3);
+            putFixed(coordinates + 8, 8, p.y, 3);
+            putFixed(coordinates + 16, 8, p.z, 3);
+            buffer_.append(coordinates, sizeof(coordinates));
+            buffer_.append(fixed + offsets_[2 * row + 1], fixed + offsets_[2 * row + 2]);
+        } else {
+            appendCifFixed(buffer_, p.x, 3);
+            buffer_ += ' ';
+            appendCifFixed(buffer_, p.y, 3);
+            buffer_ += ' ';
+            appendCifFixed(buffer_, p.z, 3);
+            buffer_.append(fixed + offsets_[2 * row + 1], fixed + offsets_[2 * row + 2]);
+            buffer_.append(number, numberLength);
+            buffer_ += '\n';
+        }
+        if (buffer_.size() >= kFlushBytes) {
+            flush();
+        }
+    }
+    if (format_ == WriteFormat::Pdb) {
+        buffer_ += "ENDMDL\n";
+    }
+    if (!frame) {
+        // Not reused: by the next write this address may hold another Model
+        cached_ = nullptr;
+    }
+    flush();
+    return is_open();
+}
+
+void Writer::prepare(const Model& model) {
+    clearCache();
+    offsets_.reserve(2 * (model.atoms.size() + model.hetAtoms.size()) + 1);
+    offsets_.push_back(0);
+    for (const auto& atom : model.atoms) {
+        appendRecord(*atom, false);
+    }
+    for (const auto& atom : model.hetAtoms) {
+        appendRecord(*atom, true);
+    }
+    cached_ = &model;
+    cachedRows_ = model.atoms.size() + model.hetAtoms.size();
+}
+
+void Writer::appendRecord(const Atom& atom, bool het) {
+    if (format_ == WriteFormat::Pdb) {
+        // Columns 1-30, then 55-80 and the newline
+        char line[81];
+        std::fill(line, line + sizeof(line), ' ');
+        std::memcpy(line, het ? "HETATM" : "ATOM  ", 6);
+        putHybrid36(line + 6, 5, atom.serial);
+        putAtomName(line + 12, atom);
+        putLeft(line + 16, 1, CodeText(atom.altLoc).view());
+        CodeText resName(atom.resName);
+        if (resName.size <= 3) {
+            putRight(line + 17, 3, resName.view());
+        } else {
+            putLeft(line + 17, 4, resName.view());
+        }
+        putLeft(line + 21, 1, CodeText(atom.chainID).view());
+        putHybrid36(line + 22, 4, atom.resSeq);
+        putLeft(line + 26, 1, CodeText(atom.iCode).view());
+        fixed_.append(line, 30);
+        offsets_.push_back(uint32_t(fixed_.size()));
+
+        putFixed(line + 54, 6, atom.occupancy, 2);
+        putFixed(line + 60, 6, atom.tempFactor, 2);
+        putRight(line + 76, 2, CodeText(atom.element).view());
+        putLeft(line + 78, 2, CodeText(atom.charge).view());
+        line[80] = '\n';
+        fixed_.append(line + 54, sizeof(line) - 54);
+        offsets_.push_back(uint32_t(fixed_.size()));
+        return;
+    }
+
+    // group_PDB through pdbx_PDB_ins_code
+    CodeText name(atom.name);
+    CodeText resName(atom.resName);
+    CodeText chainID(atom.chainID);
+    fixed_ += het ? "HETATM " : "ATOM ";
+    appendCifInt(fixed_, atom.serial);
+    fixed_ += ' ';
+    appendCifValue(fixed_, CodeText(atom.element).view(), '?');
+    fixed_ += ' ';
+    appendCifValue(fixed_, name.view(), '?');
+    fixed_ += ' ';
+    appendCifValue(fixed_, CodeText(atom.altLoc).view(), '.');
+    fixed_ += ' ';
+    appendCifValue(fixed_, resName.view(), '?');
+    fixed_ += ' ';
+    appendCifValue(fixed_, chainID.view(), '?');
+    fixed_ += ' ';
+    if (het) {
+        fixed_ += '.';
+    } else {
+        appendCifInt(fixed_, atom.resSeq);
+    }
+    fixed_ += ' ';
+    appendCifValue(fixed_, CodeText(atom.iCode).view(), '?');
+    fixed_ += ' ';
+    offsets_.push_back(uint32_t(fixed_.size()));
+
+    // occupancy through auth_atom_id; the model number follows
+    fixed_ += ' ';
+    appendCifFixed(fixed_, atom.occupancy, 2);
+    fixed_ += ' ';
+    appendCifFixed(fixed_, atom.tempFactor, 2);
+    fixed_ += ' ';
+    appendCifCharge(fixed_, atom.charge);
+    fixed_ += ' ';
+    appendCifInt(fixed_, atom.resSeq);
+    fixed_ += ' ';
+    appendCifValue(fixed_, resName.view(), '?');
+    fixed_ += ' ';
+    appendCifValue(fixed_, chainID.view(), '?');
+    fixed_ += ' ';
+    appendCifValue(fixed_, name.view(), '?');
+    fixed_ += ' ';
+    offsets_.push_back(uint32_t(fixed_.size()));
+}
+
+void Writer::flush() {
+    if (!buffer_.empty() && out_.is_open()) {
+        out_.write(buffer_.data(), std::streamsize(buffer_.size()));
+    }
+    buffer_.clear();
+}
+
+bool Writer::close() {
+    if (closed_) {
+        return !out_.fail();
+    }
+    closed_ = true;
+    if (!out_.is_open()) {
+        return false;
+    }
+    buffer_ += format_ == WriteFormat::Pdb ? "END\n" : "#\n";
+    flush();
+    out_.close();
+    return !out_.fail();
+}
+
+} // namespace pdb
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.hpp"
+#include "model.hpp"
+#include "spatial.hpp"
+#include <fstream>
+
+namespace pdb {
+
+enum class WriteFormat {
+    Pdb = 0,
+    Cif = 1   // PDBx/mmCIF _atom_site loop
+};
+
+// Streaming writer for PDB and mmCIF files. Every write() appends one model,
+// as a MODEL/ENDMDL block or as _atom_site rows with the next
+// pdbx_PDB_model_num, so simulation frames become one multi-model file.
+//
+// Fields are formatted with std::to_chars into a reusable buffer that is
+// flushed in large blocks. The identifier, occupancy, B-factor, element and
+// charge text of each atom is formatted once per run of frames of one Model,
+// so a frame only formats coordinates; write(model) always formats every
+// field. Call clearCache() after editing a Model's atoms between frames.
+// Serials and residue numbers past the PDB columns use hybrid-36, as Reader
+// expects.
+class Writer {
+public:
+    // Constructors
+    // Writes mmCIF for .cif and .mmcif paths and PDB otherwise
+    explicit Writer(const std::string& path);
+    Writer(const std::string& path, WriteFormat format);
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    bool is_open() const { return out_.is_open() && out_.good(); }
+    WriteFormat format() const { return format_; }
+    size_t models() const { return models_; }
+
+    // Appends model with its own coordinates
+    bool write(const Model& model);
+    // Appends model with coordinates taken from one Point per row in Model
+    // order (atoms, then hetAtoms), e.g. a simulation frame; returns false
+    // if the sizes differ. Consecutive frames of the same Model reuse the
+    // formatted text; any other write() discards it.
+    bool write(const Model& model, const std::vector<Point>& coordinates);
+
+    void clearCache();
+
+    // Writes the trailer and flushes; returns false if any write failed
+    bool close();
+
+private:
+    // Flushes once the buffer holds this many bytes
+    static constexpr size_t kFlushBytes = size_t(1) << 20;
+
+    template <typename Position>
+    bool writeRows(const Model& model, const Position& position, bool frame);
+    void prepare(const Model& model);
+    void appendRecord(const Atom& atom, bool het);
+    void flush();
+
+    std::string path_;
+    WriteFormat format_;
+    std::ofstream out_;
+    std::string buffer_;
+    size_t models_{0};
+    bool closed_{false};
+
+    // Per-row text around the coordinates: row i is fixed_[offsets_[2i],
+    // offsets_[2i + 1]), coordinates, then fixed_[offsets_[2i + 1],
+    // offsets_[2i + 2]). Only kept between consecutive frames, since a
+    // Model address can be reused once that Model is freed
+    const Model* cached_{nullptr};
+    size_t cachedRows_{0};
+    std::string fixed_;
+    std::vector<uint32_t> offsets_;
+};
+
+} // namespace pdb
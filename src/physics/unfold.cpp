@@ -1,6 +1,7 @@
 #include "physics/unfold.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <unordered_map>
 
 using namespace pdb;
 
@@ -44,14 +45,20 @@ UnfoldSim::UnfoldSim(const Model& model){
     std::vector<std::pair<int,int>> chainResidueIndices; // (chain index, residue index) positions for mapping if needed
     for (const auto& chain : model.chains){
         for (const auto& res : chain->residues){
-            for (const auto& atom : res->atoms){
-                if (atom->name == "CA"){
-                    caPos.emplace_back((float)atom->x, (float)atom->y, (float)atom->z);
-                }
+            if (const pdb::Atom* ca = res->ca()){
+                caPos.emplace_back((float)ca->x, (float)ca->y, (float)ca->z);
+                atoms_.push_back(ca);
             }
         }
     }
 
+    // Model row of each CA, for copyPositions()
+    std::unordered_map<const pdb::Atom*, uint32_t> rowOf;
+    for (const auto* atoms : {&model.atoms, &model.hetAtoms}){
+        for (const auto& atom : *atoms) rowOf.emplace(atom, uint32_t(rowOf.size()));
+    }
+    for (const pdb::Atom* ca : atoms_) rows_.push_back(rowOf.at(ca));
+
     bodies_.reserve(caPos.size());
 
     // Create rigid bodies for each CA
@@ -142,6 +149,13 @@ void UnfoldSim::applyPulling(float magnitude){
     b->applyCentralForce( f);
 }
 
+void UnfoldSim::copyPositions(std::vector<pdb::Point>& frame) const{
+    for (size_t i = 0; i < bodies_.size(); ++i){
+        const btVector3& p = bodies_[i]->getWorldTransform().getOrigin();
+        frame[rows_[i]] = pdb::Point{float(p.x()), float(p.y()), float(p.z())};
+    }
+}
+
 std::vector<glm::vec3> UnfoldSim::getCAPositions() const{
     std::vector<glm::vec3> out; out.reserve(bodies_.size());
     for (auto* b : bodies_){
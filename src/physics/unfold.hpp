@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <btBulletDynamicsCommon.h>
 #include "pdb/model.hpp"
+#include "pdb/spatial.hpp"
 
 class UnfoldSim {
 public:
@@ -24,6 +25,14 @@ public:
     // Count of CA nodes
     size_t size() const { return bodies_.size(); }
 
+    // Model CA atom of each node, in the order of getCAPositions()
+    const std::vector<const pdb::Atom*>& atoms() const { return atoms_; }
+
+    // Writes current CA positions into frame, one Point per row (atoms, then
+    // hetAtoms) of the model the sim was built from, e.g. from
+    // pdb::positionsOf; other rows keep their values
+    void copyPositions(std::vector<pdb::Point>& frame) const;
+
 private:
     // Bullet world
     std::unique_ptr<btDefaultCollisionConfiguration> collisionConfig_;
@@ -38,6 +47,8 @@ private:
     // Bodies representing CA atoms (in chain order)
     std::vector<btRigidBody*> bodies_;
     std::vector<btTypedConstraint*> constraints_;
+    std::vector<const pdb::Atom*> atoms_;
+    std::vector<uint32_t> rows_;  // Model row of each node
 
     // Helpers
     static btTransform makeFrame(const btVector3& localOrigin, const btVector3& axis);
@@ -0,0 +1,83 @@
+#include "tube.hpp"
+#include <cmath>
+
+std::vector<glm::vec3> getCAPositions(const pdb::Model &model)
+{
+    std::vector<glm::vec3> ca_positions;
+    for (const auto &chain : model.chains)
+    {
+        for (const auto &res : chain->residues)
+        {
+            if (const pdb::Atom *ca = res->ca())
+            {
+                ca_positions.push_back(glm::vec3(ca->x, ca->y, ca->z));
+            }
+        }
+    }
+    return ca_positions;
+}
+
+std::vector<Vertex> generateTubeVertices(const std::vector<glm::vec3> &ca_positions, int segments, float radius)
+{
+    std::vector<Vertex> vertices;
+    for (size_t i = 0; i < ca_positions.size(); ++i)
+    {
+        glm::vec3 p = ca_positions[i];
+        glm::vec3 dir;
+        if (i == 0)
+            dir = glm::normalize(ca_positions[i + 1] - p);
+        else if (i == ca_positions.size() - 1)
+            dir = glm::normalize(p - ca_positions[i - 1]);
+        else
+            dir = glm::normalize(ca_positions[i + 1] - ca_positions[i - 1]);
+
+        glm::vec3 up = glm::vec3(0, 1, 0);
+        if (fabs(glm::dot(dir, up)) > 0.99f)
+            up = glm::vec3(1, 0, 0);
+        glm::vec3 right = glm::normalize(glm::cross(dir, up));
+        glm::vec3 normal = glm::normalize(glm::cross(right, dir));
+
+        for (int j = 0; j < segments; ++j)
+        {
+            float theta = 2.0f * 3.1415926f * float(j) / float(segments);
+            glm::vec3 circ = (right * cosf(theta) * radius) + (normal * sinf(theta) * radius);
+            Vertex v;
+            v.Position = p + circ;
+            v.Normal = glm::normalize(circ);
+            vertices.push_back(v);
+        }
+    }
+    return vertices;
+}
+
+std::vector<std::vector<unsigned int>> generateTubeIndices(const std::vector<glm::vec3> &ca_positions, int segments, float maxDistance)
+{
+    std::vector<std::vector<unsigned int>> indices(1);
+    int k = 0;
+    for (size_t i = 1; i < ca_positions.size(); ++i)
+    {
+        float dist = glm::distance(ca_positions[i], ca_positions[i - 1]);
+        if (dist > maxDistance)
+        {
+            indices.push_back(std::vector<unsigned int>());
+            k++;
+            continue;
+        }
+        for (int j = 0; j < segments; ++j)
+        {
+            int curr = (i - 1) * segments + j;
+            int next = i * segments + j;
+            int curr_next = (i - 1) * segments + (j + 1) % segments;
+            int next_next = i * segments + (j + 1) % segments;
+
+            indices[k].push_back(curr);
+            indices[k].push_back(next);
+            indices[k].push_back(curr_next);
+
+            indices[k].push_back(curr_next);
+            indices[k].push_back(next);
+            indices[k].push_back(next_next);
+        }
+    }
+    return indices;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh.hpp"
+#include "pdb/model.hpp"
+
+// Tube geometry along the CA trace. Only the Vertex layout is shared with
+// Mesh, so this builds without OpenGL.
+
+// CA positions of every residue, in chain order
+std::vector<glm::vec3> getCAPositions(const pdb::Model &model);
+
+// A ring of segments vertices around each CA position
+std::vector<Vertex> generateTubeVertices(const std::vector<glm::vec3> &ca_positions, int segments, float radius);
+
+// Triangle indices joining consecutive rings, split into one group per run
+// of CAs closer than maxDistance
+std::vector<std::vector<unsigned int>> generateTubeIndices(const std::vector<glm::vec3> &ca_positions, int segments, float maxDistance);
@@ -0,0 +1,153 @@
+// foldgl-bench-reader: writes a synthetic single-model PDB file and times
+// pdb::Reader on it, once through an istream and once on a memory-mapped
+// buffer, so the two modes can be compared on any machine.
+//
+//   foldgl-bench-reader [atoms] [repeat] [output.pdb]
+//
+// The file holds protein-like ATOM records with random coordinates and a
+// new chain every 500 residues (default 2,000,000 atoms, about 160 MB). It is
+// deleted afterwards unless an output path is given. Both modes must produce
+// the same model digest.
+#include "pdb/model.hpp"
+#include "utils/mapped_file.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kResiduesPerChain = 500;
+
+struct SyntheticAtom {
+    const char* name;
+    const char* element;
+};
+
+constexpr SyntheticAtom kResidueAtoms[] = {
+    {" N  ", "N"}, {" CA ", "C"}, {" C  ", "C"}, {" O  ", "O"},
+    {" CB ", "C"}, {" CG ", "C"}, {" OD1", "O"}
+};
+constexpr const char* kResidueNames[] = {"ALA", "GLY", "SER", "ASP", "LYS", "LEU"};
+
+// Writes atomCount ATOM records from a fixed seed, so every run benchmarks
+// the same bytes; returns false on a write error
+bool writeSynthetic(const fs::path& path, size_t atomCount) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> coordinate(-999.0, 999.0);
+    std::uniform_real_distribution<double> bFactor(0.0, 99.0);
+
+    out << "HEADER    SYNTHETIC BENCHMARK\n";
+    char line[96];
+    size_t atom = 0;
+    for (int residue = 0; atom < atomCount; ++residue) {
+        const char* resName = kResidueNames[random() % std::size(kResidueNames)];
+        char chainID = char('A' + (residue / kResiduesPerChain) % 26);
+        int resSeq = residue % kResiduesPerChain + 1;
+        for (const SyntheticAtom& a : kResidueAtoms) {
+            if (atom == atomCount) {
+                break;
+            }
+            double x = coordinate(random), y = coordinate(random), z = coordinate(random);
+            int length = std::snprintf(line, sizeof(line),
+                                       "ATOM  %5d %4s %3s %c%4d    %8.3f%8.3f%8.3f%6.2f%6.2f          %2s  \n",
+                                       int(atom % 100000), a.name, resName, chainID, resSeq,
+                                       x, y, z, 1.0, bFactor(random), a.element);
+            out.write(line, length);
+            ++atom;
+        }
+    }
+    out << "END\n";
+    out.close();
+    return bool(out);
+}
+
+// Order-dependent hash of what the reader produced
+uint64_t digest(const std::vector<std::unique_ptr<pdb::Model>>& models) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](uint64_t value) {
+        hash = (hash ^ value) * 1099511628211ull;
+    };
+    for (const auto& model : models) {
+        mix(model->atoms.size());
+        mix(model->residues.size());
+        mix(model->chains.size());
+        for (const auto& atom : model->atoms) {
+            mix(uint64_t(atom->serial));
+            mix(atom->name.value());
+            mix(uint64_t(int64_t(std::llround(atom->x * 1000.0))));
+            mix(uint64_t(int64_t(std::llround(atom->y * 1000.0))));
+            mix(uint64_t(int64_t(std::llround(atom->z * 1000.0))));
+        }
+    }
+    return hash;
+}
+
+template <typename Load>
+double bestOf(int repeat, uint64_t& hash, Load load) {
+    double best = 0.0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<pdb::Model>> models = load();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+        hash = digest(models);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t atoms = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int repeat = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (atoms == 0 || repeat < 1) {
+        std::cerr << "Usage: " << argv[0] << " [atoms] [repeat] [output.pdb]" << std::endl;
+        return 1;
+    }
+    bool keep = argc > 3;
+    fs::path path = keep ? fs::path(argv[3])
+                         : fs::temp_directory_path() / ("foldgl-bench-" + std::to_string(atoms) + ".pdb");
+
+    if (!writeSynthetic(path, atoms)) {
+        std::cerr << "Cannot write " << path.string() << std::endl;
+        return 1;
+    }
+    std::error_code ec;
+    double megabytes = double(fs::file_size(path, ec)) / (1024.0 * 1024.0);
+
+    uint64_t streamHash = 0, mappedHash = 0;
+    double streamSeconds = bestOf(repeat, streamHash, [&] {
+        std::ifstream in(path, std::ios::binary);
+        return pdb::Reader(in).readAll();
+    });
+    double mappedSeconds = bestOf(repeat, mappedHash, [&] {
+        MappedFile file(path.string());
+        return pdb::Reader(file.view()).readAll();
+    });
+    if (!keep) {
+        fs::remove(path, ec);
+    }
+
+    std::printf("%zu atoms, %.1f MB, best of %d\n", atoms, megabytes, repeat);
+    std::printf("istream  %.3f s\n", streamSeconds);
+    std::printf("mmap     %.3f s\n", mappedSeconds);
+    if (streamHash != mappedHash) {
+        std::fprintf(stderr, "Digest mismatch: %016llx vs %016llx\n",
+                     (unsigned long long)streamHash, (unsigned long long)mappedHash);
+        return 1;
+    }
+    return 0;
+}
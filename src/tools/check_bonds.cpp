@@ -0,0 +1,206 @@
+// foldgl-check-bonds: checks BondGraph::fromModel on a small peptide and
+// perceiveBonds on a random atom cloud, both written in memory.
+//
+//   foldgl-check-bonds [atoms] [seed]
+//
+// ALA 1, MSE 2 (HETATM) and GLY 3 must get exactly their template bonds
+// and the two peptide bonds through MSE. perceiveBonds must find the same
+// bonds as testing every pair of atoms (default 3000 atoms). Exits non-zero
+// and prints each failed check.
+#include "pdb/atom_table.hpp"
+#include "pdb/bonds.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <random>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+struct PeptideAtom {
+    const char* name;
+    const char* element;
+    double x, y, z;  // Relative to the residue's N
+};
+
+// Backbone shared by all residues; the next residue's N sits 1.33 A past C
+constexpr PeptideAtom kBackbone[] = {
+    {" N  ", "N", 0.0, 0.0, 0.0}, {" CA ", "C", 1.45, 0.0, 0.0},
+    {" C  ", "C", 2.0, 1.4, 0.0}, {" O  ", "O", 1.4, 2.4, 0.3},
+};
+constexpr double kNextResidue[3] = {3.33, 1.4, 0.0};
+
+void appendAtom(std::string& text, int& serial, bool het, const char* resName, int resSeq,
+                const PeptideAtom& atom) {
+    char line[96];
+    double x = atom.x + kNextResidue[0] * (resSeq - 1);
+    double y = atom.y + kNextResidue[1] * (resSeq - 1);
+    double z = atom.z + kNextResidue[2] * (resSeq - 1);
+    std::snprintf(line, sizeof(line),
+                  "%-6s%5d %4s %3s A%4d    %8.3f%8.3f%8.3f%6.2f%6.2f          %2s  \n",
+                  het ? "HETATM" : "ATOM", serial++, atom.name, resName, resSeq,
+                  x, y, z, 1.0, 20.0, atom.element);
+    text += line;
+}
+
+void appendResidue(std::string& text, int& serial, bool het, const char* resName, int resSeq,
+                   std::initializer_list<PeptideAtom> sideChain) {
+    for (const PeptideAtom& atom : kBackbone) {
+        appendAtom(text, serial, het, resName, resSeq, atom);
+    }
+    for (const PeptideAtom& atom : sideChain) {
+        appendAtom(text, serial, het, resName, resSeq, atom);
+    }
+}
+
+void checkTemplates() {
+    std::string text;
+    int serial = 1;
+    appendResidue(text, serial, false, "ALA", 1, {{" CB ", "C", 2.0, -0.9, 1.1}});
+    appendResidue(text, serial, true, "MSE", 2,
+                  {{" CB ", "C", 2.0, -0.9, 1.1}, {" CG ", "C", 2.6, -2.2, 1.6},
+                   {"SE  ", "SE", 2.1, -3.1, 3.3}, {" CE ", "C", 3.2, -4.6, 3.6}});
+    appendResidue(text, serial, false, "GLY", 3, {{" OXT", "O", 3.2, 1.6, -0.4}});
+    text += "END\n";
+
+    auto model = pdb::Reader(std::string_view(text)).read();
+    check(model && model->atoms.size() == 10 && model->hetAtoms.size() == 8,
+          "ALA and GLY in atoms, MSE in hetAtoms");
+    if (!model || model->atoms.size() != 10 || model->hetAtoms.size() != 8) {
+        return;
+    }
+
+    // Rows: ALA N CA C O CB 0-4, GLY N CA C O OXT 5-9, MSE N CA C O CB CG
+    // SE CE 10-17
+    pdb::BondGraph graph = pdb::BondGraph::fromModel(*model);
+    check(graph.atomCount() == 18, "one graph row per atom");
+    // ALA 4 + GLY 4 + MSE 7 template bonds, 2 peptide bonds
+    check(graph.bondCount() == 17, "17 bonds");
+    check(graph.bonded(1, 4), "ALA CA-CB");
+    check(graph.bonded(7, 9), "GLY C-OXT");
+    check(graph.bonded(15, 16) && graph.bonded(16, 17), "MSE CG-SE and SE-CE");
+    check(graph.bonded(2, 10), "peptide bond ALA C - MSE N");
+    check(graph.bonded(12, 5), "peptide bond MSE C - GLY N");
+    check(!graph.bonded(2, 5), "no bond ALA C - GLY N across MSE");
+}
+
+// Element, or the first letter of the name if blank, as perceiveBonds does
+pdb::Code bondElement(const pdb::AtomTable& table, size_t row) {
+    if (!table.element[row].empty()) {
+        return table.element[row];
+    }
+    std::string name = table.name[row].str();
+    auto letter = std::find_if(name.begin(), name.end(), [](unsigned char c) { return std::isalpha(c); });
+    return letter == name.end() ? pdb::Code(" ") : pdb::Code(std::string(1, *letter));
+}
+
+// Atoms of mixed elements, some without an element column and some in
+// alternate locations, at random in a box dense enough for many bonds
+void checkPerception(size_t atomCount, unsigned long long seed) {
+    static const char* const kElements[] = {"C", "N", "O", "S", "SE", "FE", "H", ""};
+    static const char kAltLocs[] = {' ', ' ', ' ', 'A', 'B'};
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> coordinate(0.0, std::cbrt(double(atomCount)) * 1.8);
+
+    std::string text;
+    char line[96];
+    for (size_t i = 0; i < atomCount; ++i) {
+        const char* element = kElements[random() % std::size(kElements)];
+        char altLoc = kAltLocs[random() % std::size(kAltLocs)];
+        // A blank element column leaves the name to decide
+        const char* name = *element ? " X  " : (random() % 2 ? " N1 " : " CA ");
+        std::snprintf(line, sizeof(line),
+                      "HETATM%5d %4s%cLIG A%4d    %8.3f%8.3f%8.3f%6.2f%6.2f          %2s  \n",
+                      int(i % 100000), name, altLoc, int(i / 10), coordinate(random),
+                      coordinate(random), coordinate(random), 1.0, 20.0, element);
+        text += line;
+    }
+    text += "END\n";
+    auto model = pdb::Reader(std::string_view(text)).read();
+    if (!model) {
+        check(false, "random cloud parses");
+        return;
+    }
+    pdb::AtomTable table(*model);
+    size_t count = table.size();
+
+    const float tolerance = 0.45f;
+    std::vector<float> radius(count);
+    for (size_t i = 0; i < count; ++i) {
+        radius[i] = pdb::covalentRadius(bondElement(table, i));
+    }
+    std::vector<pdb::BondGraph::Bond> expected;
+    std::vector<char> borderline;  // Within rounding of a limit: either answer is fine
+    for (uint32_t a = 0; a < count; ++a) {
+        for (uint32_t b = a + 1; b < count; ++b) {
+            float dx = table.x[a] - table.x[b], dy = table.y[a] - table.y[b], dz = table.z[a] - table.z[b];
+            float d2 = dx * dx + dy * dy + dz * dz;
+            float limit = radius[a] + radius[b] + tolerance;
+            bool altOk = table.altLoc[a] == ' ' || table.altLoc[b] == ' ' || table.altLoc[a] == table.altLoc[b];
+            bool near = std::fabs(d2 - limit * limit) < 1e-3f || std::fabs(d2 - 0.16f) < 1e-3f;
+            if (altOk && (near || (d2 <= limit * limit && d2 >= 0.16f))) {
+                expected.emplace_back(a, b);
+                borderline.push_back(near);
+            }
+        }
+    }
+
+    std::vector<pdb::BondGraph::Bond> found = pdb::perceiveBonds(table, tolerance);
+    for (auto& bond : found) {
+        if (bond.first > bond.second) {
+            std::swap(bond.first, bond.second);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    check(std::adjacent_find(found.begin(), found.end()) == found.end(), "perceiveBonds lists each bond once");
+
+    // expected is sorted by construction; every certain bond must be found
+    // and nothing outside expected may be
+    size_t missing = 0, extra = 0;
+    size_t e = 0;
+    for (const auto& bond : found) {
+        while (e < expected.size() && expected[e] < bond) {
+            missing += !borderline[e];
+            ++e;
+        }
+        if (e < expected.size() && expected[e] == bond) {
+            ++e;
+        } else {
+            ++extra;
+        }
+    }
+    for (; e < expected.size(); ++e) {
+        missing += !borderline[e];
+    }
+    std::printf("perceiveBonds: %zu atoms, %zu bonds, %zu missing, %zu extra\n",
+                count, found.size(), missing, extra);
+    check(found.size() > count / 2, "random cloud has bonds to compare");
+    check(missing == 0 && extra == 0, "perceiveBonds matches the all-pairs check");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t atoms = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 3000;
+    unsigned long long seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 42;
+    if (atoms < 2) {
+        std::fprintf(stderr, "Usage: %s [atoms] [seed]\n", argv[0]);
+        return 1;
+    }
+    checkTemplates();
+    checkPerception(atoms, seed);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
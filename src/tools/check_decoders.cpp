@@ -0,0 +1,183 @@
+// foldgl-check-decoders: differential check of the fixed-column decoders in
+// pdb/common.hpp against the C library.
+//
+//   foldgl-check-decoders [iterations] [seed]
+//
+// Random fields in the PDB layouts (%8.3f coordinates, %6.2f occupancies),
+// %g forms with exponents, random garbage and random integer fields are
+// decoded with decodeFloat/decodeInt and with strtod/strtol. A field the C
+// library consumes completely must decode to the same bits; any other field
+// must be rejected. Hybrid-36 values must survive an encode/decode round
+// trip. Exits non-zero and prints the first mismatches if any check fails.
+#include "pdb/common.hpp"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int kMaxReports = 10;
+
+struct Counts {
+    long fields{0};
+    long matched{0};
+    long failures{0};
+};
+
+void report(Counts& counts, const char* format, const std::string& field, double expected, double got) {
+    if (counts.failures++ < kMaxReports) {
+        std::printf(format, field.c_str(), expected, got);
+    }
+}
+
+// strtod over the whole trimmed field; hex, inf and nan forms are not PDB
+// numbers and are treated as rejected. Underflow is reported separately,
+// since from_chars and strtod differ on subnormal results.
+enum class Reference { Accepted, Rejected, Overflow, Underflow };
+
+Reference referenceFloat(const std::string& field, double& value) {
+    if (field.empty() || field.find_first_of("xXnNiI") != std::string::npos) {
+        return Reference::Rejected;
+    }
+    errno = 0;
+    char* end = nullptr;
+    value = std::strtod(field.c_str(), &end);
+    if (end != field.c_str() + field.size()) {
+        return Reference::Rejected;
+    }
+    if (errno == ERANGE) {
+        return std::isinf(value) ? Reference::Overflow : Reference::Underflow;
+    }
+    return Reference::Accepted;
+}
+
+void checkFloat(const std::string& raw, Counts& counts) {
+    std::string field(pdb::trim(raw));
+    double expected = 0.0;
+    Reference reference = referenceFloat(field, expected);
+    double got = 0.0;
+    pdb::ParseStatus status = pdb::decodeFloat(raw, got);
+    ++counts.fields;
+
+    switch (reference) {
+    case Reference::Accepted:
+        if (status != pdb::ParseStatus::Ok || std::memcmp(&got, &expected, sizeof(got)) != 0) {
+            report(counts, "float '%s': strtod %.17g, decodeFloat %.17g\n", raw, expected, got);
+        } else {
+            ++counts.matched;
+        }
+        break;
+    case Reference::Overflow:
+        if (status != pdb::ParseStatus::Overflow) {
+            report(counts, "float '%s': strtod overflows (%g), decodeFloat %.17g\n", raw, expected, got);
+        }
+        break;
+    case Reference::Underflow:
+        break;
+    case Reference::Rejected:
+        if (status == pdb::ParseStatus::Ok) {
+            report(counts, "float '%s': strtod rejects (%g), decodeFloat %.17g\n", raw, expected, got);
+        }
+        break;
+    }
+}
+
+void checkInt(const std::string& raw, Counts& counts) {
+    std::string field(pdb::trim(raw));
+    errno = 0;
+    char* end = nullptr;
+    long expected = field.empty() ? 0 : std::strtol(field.c_str(), &end, 10);
+    bool accepted = !field.empty() && end == field.c_str() + field.size() &&
+                    errno != ERANGE && expected >= INT_MIN && expected <= INT_MAX;
+    int got = 0;
+    pdb::ParseStatus status = pdb::decodeInt(raw, got);
+    ++counts.fields;
+
+    if (accepted != (status == pdb::ParseStatus::Ok) || (accepted && got != expected)) {
+        report(counts, "int '%s': strtol %.0f, decodeInt %.0f\n", raw, double(expected), double(got));
+    } else if (accepted) {
+        ++counts.matched;
+    }
+}
+
+void checkHybrid36(int value, int width, Counts& counts) {
+    char text[8] = {};
+    ++counts.fields;
+    if (!pdb::encodeHybrid36(value, width, text)) {
+        return;
+    }
+    int got = 0;
+    std::string field(text, width);
+    if (pdb::decodeHybrid36(field, width, got) != pdb::ParseStatus::Ok || got != value) {
+        report(counts, "hybrid-36 '%s': encoded %.0f, decoded %.0f\n", field, double(value), double(got));
+    } else {
+        ++counts.matched;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+    unsigned long long seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 42;
+    if (iterations < 1) {
+        std::fprintf(stderr, "Usage: %s [iterations] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> coordinate(-9999.999, 99999.999);
+    std::uniform_real_distribution<double> occupancy(-99.0, 999.0);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    const char garbage[] = " 0123456789.-+eE x";
+    const char digits[] = " 0123456789-+";
+
+    Counts floats, ints, hybrid;
+    char buffer[64];
+    for (long i = 0; i < iterations; ++i) {
+        std::string field;
+        switch (i % 4) {
+        case 0:
+            std::snprintf(buffer, sizeof(buffer), "%8.3f", coordinate(random));
+            field = buffer;
+            break;
+        case 1:
+            std::snprintf(buffer, sizeof(buffer), "%6.2f", occupancy(random));
+            field = buffer;
+            break;
+        case 2:
+            for (int length = 1 + int(random() % 20); length > 0; --length) {
+                field += garbage[random() % (sizeof(garbage) - 1)];
+            }
+            break;
+        default:
+            std::snprintf(buffer, sizeof(buffer), "%.*g", int(1 + random() % 18),
+                          std::ldexp(unit(random), int(random() % 200) - 100));
+            field = buffer;
+            break;
+        }
+        checkFloat(field, floats);
+
+        field.clear();
+        for (int length = 1 + int(random() % 11); length > 0; --length) {
+            field += digits[random() % (sizeof(digits) - 1)];
+        }
+        checkInt(field, ints);
+
+        int width = random() % 2 ? 5 : 4;
+        checkHybrid36(int(random() % 120000000), width, hybrid);
+    }
+
+    std::printf("decodeFloat     %ld fields, %ld numbers matched strtod, %ld failures\n",
+                floats.fields, floats.matched, floats.failures);
+    std::printf("decodeInt       %ld fields, %ld numbers matched strtol, %ld failures\n",
+                ints.fields, ints.matched, ints.failures);
+    std::printf("decodeHybrid36  %ld values, %ld round trips, %ld failures\n",
+                hybrid.fields, hybrid.matched, hybrid.failures);
+    return floats.failures + ints.failures + hybrid.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// foldgl-check-model: checks how Reader groups atoms into residues and
+// assigns secondary structure, on small structures written in memory.
+//
+//   foldgl-check-model
+//
+// Insertion codes (52 and 52A) and chain changes on one resSeq must start
+// new residues, and HELIX/SHEET ranges must match (chain, resSeq, iCode).
+// Exits non-zero and prints each failed check.
+#include "pdb/model.hpp"
+#include <cstdio>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// N, CA, C and O of one residue; x is the residue's position along the
+// chain, so ca()->x tells residues apart
+void appendResidue(std::string& text, int& serial, const char* resName, char chainID,
+                   int resSeq, char iCode, double x) {
+    static const char* const kNames[4] = {" N  ", " CA ", " C  ", " O  "};
+    static const char* const kElements[4] = {"N", "C", "C", "O"};
+    char line[96];
+    for (int i = 0; i < 4; ++i) {
+        std::snprintf(line, sizeof(line),
+                      "ATOM  %5d %4s %3s %c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f          %2s  \n",
+                      serial++, kNames[i], resName, chainID, resSeq, iCode,
+                      x + 0.4 * i, 0.0, 0.0, 1.0, 20.0, kElements[i]);
+        text += line;
+    }
+}
+
+void appendHelix(std::string& text, char chainID, int initSeq, char initICode, int endSeq, char endICode) {
+    char line[96];
+    std::snprintf(line, sizeof(line),
+                  "HELIX    1   1 ALA %c %4d%c ALA %c %4d%c 1%30s %5d    \n",
+                  chainID, initSeq, initICode, chainID, endSeq, endICode, "", 3);
+    text += line;
+}
+
+// Residues 50, 51, 52, 52A and 53 of chain A, after the given header
+std::unique_ptr<pdb::Model> insertionModel(const std::string& header) {
+    std::string text = header;
+    int serial = 1;
+    appendResidue(text, serial, "ALA", 'A', 50, ' ', 0.0);
+    appendResidue(text, serial, "GLY", 'A', 51, ' ', 10.0);
+    appendResidue(text, serial, "SER", 'A', 52, ' ', 20.0);
+    appendResidue(text, serial, "THR", 'A', 52, 'A', 30.0);
+    appendResidue(text, serial, "LYS", 'A', 53, ' ', 40.0);
+    text += "END\n";
+    return pdb::Reader(std::string_view(text)).read();
+}
+
+pdb::ResidueType typeOf(const pdb::Model& model, int resSeq, char iCode) {
+    for (const auto& residue : model.residues) {
+        if (residue->resSeq == resSeq && residue->iCode == pdb::parseCode(std::string_view(&iCode, 1))) {
+            return residue->type;
+        }
+    }
+    return pdb::ResidueType::Unknown;
+}
+
+void checkInsertionCodes() {
+    auto model = insertionModel("");
+    check(model && model->residues.size() == 5, "52 and 52A are separate residues");
+    if (!model || model->residues.size() != 5) {
+        return;
+    }
+    const pdb::Residue& r52 = *model->residues[2];
+    const pdb::Residue& r52A = *model->residues[3];
+    check(r52.atoms.size() == 4 && r52A.atoms.size() == 4, "52 and 52A hold four atoms each");
+    check(r52.ca() && r52.ca()->x == 20.4, "ca() of 52 is its own CA");
+    check(r52A.ca() && r52A.ca()->x == 30.4, "ca() of 52A is its own CA");
+    check(r52A.iCode == pdb::Code("A"), "52A keeps its insertion code");
+}
+
+void checkSecondaryStructure() {
+    std::string header;
+    appendHelix(header, 'A', 50, ' ', 52, ' ');
+    auto model = insertionModel(header);
+    check(model && typeOf(*model, 52, ' ') == pdb::ResidueType::Helix, "helix ending at 52 covers 52");
+    check(model && typeOf(*model, 52, 'A') == pdb::ResidueType::Coil, "helix ending at 52 leaves 52A as coil");
+
+    header.clear();
+    appendHelix(header, 'A', 52, 'A', 53, ' ');
+    model = insertionModel(header);
+    check(model && typeOf(*model, 52, 'A') == pdb::ResidueType::Helix, "helix starting at 52A covers 52A");
+    check(model && typeOf(*model, 52, ' ') == pdb::ResidueType::Coil, "helix starting at 52A leaves 52 as coil");
+}
+
+void checkChainChange() {
+    std::string text;
+    int serial = 1;
+    appendResidue(text, serial, "ALA", 'A', 1, ' ', 0.0);
+    appendResidue(text, serial, "GLY", 'A', 2, ' ', 10.0);
+    appendResidue(text, serial, "SER", 'B', 2, ' ', 20.0);
+    text += "END\n";
+    auto model = pdb::Reader(std::string_view(text)).read();
+    check(model && model->residues.size() == 3, "a chain change on one resSeq starts a new residue");
+    check(model && model->chainRanges.size() == 2 && model->chainRangesMatch(), "chain ranges match the lists");
+}
+
+} // namespace
+
+int main() {
+    checkInsertionCodes();
+    checkSecondaryStructure();
+    checkChainChange();
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
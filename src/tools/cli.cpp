@@ -0,0 +1,409 @@
+// foldgl-cli: batch processing without a display. Structures are processed
+// in parallel on a thread pool and results are reported in input order.
+//
+//   foldgl-cli <command> [options] <directory|file|@list>...
+//
+// Commands:
+//   convert -o DIR [--format pdb|cif]   Write each structure to DIR/<id>.pdb
+//                                        or DIR/<id>.cif
+//   stats                                One line of counts per structure,
+//                                        bonds from BondGraph::fromModel and
+//                                        from distances (perceiveBonds)
+//   unfold -o DIR [--steps N] [--every N] [--pull F] [--dt S]
+//                                        Run the unfolding simulation on the
+//                                        CA trace and write the frames to
+//                                        DIR/<id>_unfold.pdb
+//   bench [--repeat N]                   Compare parse times: istream
+//                                        getline, mmap, and the .fgl cache
+//
+// Common options: -j N worker threads, shared by the inputs and the parsing
+// within each (default: one per core), --select EXPR to keep only matching
+// atoms (see pdb/selection.hpp).
+#include "pdb/atom_table.hpp"
+#include "pdb/bcif.hpp"
+#include "pdb/bonds.hpp"
+#include "pdb/cache.hpp"
+#include "pdb/cif.hpp"
+#include "pdb/selection.hpp"
+#include "pdb/writer.hpp"
+#include "physics/unfold.hpp"
+#include "utils/gzip_stream.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/parallel.hpp"
+#include "tools/inputs.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string command;
+    std::string outputDir;
+    pdb::WriteFormat format{pdb::WriteFormat::Pdb};
+    std::unique_ptr<pdb::Selector> selector;
+    size_t threads{0};
+    size_t nestedThreads{0};  // Per input, inside the -j pool
+    int steps{2000};
+    int every{100};
+    float pull{1000.0f};
+    float dt{1.0f / 60.0f};
+    int repeat{3};
+    std::vector<fs::path> inputs;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <command> [options] <directory|file|@list>...\n"
+              << "Commands:\n"
+              << "  convert -o DIR [--format pdb|cif]  Write each structure to DIR/<id>.<format>\n"
+              << "  stats                               One line of counts per structure\n"
+              << "  unfold -o DIR [--steps N] [--every N] [--pull F] [--dt S]\n"
+              << "                                      Simulate unfolding, writing DIR/<id>_unfold.pdb\n"
+              << "  bench [--repeat N]                  Compare getline, mmap and cache parse times\n"
+              << "Options:\n"
+              << "  -j N           Worker threads (default: one per core)\n"
+              << "  --select EXPR  Keep only atoms matching the selection\n";
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Inputs sharing a structure ID (dir/a/1abc.pdb and dir/b/1abc.pdb, or
+// 1abc.pdb and 1abc.cif) would be written to one output file from two
+// threads; prints each clash and returns false if there is any
+bool checkStructureIds(const std::vector<fs::path>& inputs) {
+    std::unordered_map<std::string, size_t> firstInput;
+    bool unique = true;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        std::string id = tools::structureId(inputs[i]);
+        auto [it, added] = firstInput.emplace(id, i);
+        if (!added) {
+            std::cerr << "Duplicate structure ID '" << id << "': " << inputs[it->second].string()
+                      << " and " << inputs[i].string() << std::endl;
+            unique = false;
+        }
+    }
+    return unique;
+}
+
+// Parses the command line; prints the problem and returns false on an error
+bool parseOptions(int argc, char** argv, Options& options) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return false;
+    }
+    options.command = argv[1];
+    if (options.command != "convert" && options.command != "stats" &&
+        options.command != "unfold" && options.command != "bench") {
+        std::cerr << "Unknown command '" << options.command << "'" << std::endl;
+        printUsage(argv[0]);
+        return false;
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        auto number = [&](double low) {
+            char* end = nullptr;
+            double value = std::strtod(argv[++i], &end);
+            if (*end != '\0' || !(value >= low)) {
+                std::cerr << "Bad value '" << argv[i] << "' for " << arg << std::endl;
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return value;
+        };
+        double value = 0.0;
+        if (arg == "-o" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format != "pdb" && format != "cif") {
+                std::cerr << "Unknown format '" << format << "'" << std::endl;
+                return false;
+            }
+            options.format = format == "cif" ? pdb::WriteFormat::Cif : pdb::WriteFormat::Pdb;
+        } else if (arg == "--select" && hasValue) {
+            std::string error;
+            options.selector = pdb::Selector::compile(argv[++i], &error);
+            if (!options.selector) {
+                std::cerr << "Bad selection '" << argv[i] << "': " << error << std::endl;
+                return false;
+            }
+        } else if (arg == "-j" && hasValue) {
+            if (std::isnan(value = number(0.0))) {
+                return false;
+            }
+            options.threads = size_t(value);
+        } else if (arg == "--steps" && hasValue) {
+            if (std::isnan(value = number(0.0))) {
+                return false;
+            }
+            options.steps = int(value);
+        } else if (arg == "--every" && hasValue) {
+            if (std::isnan(value = number(1.0))) {
+                return false;
+            }
+            options.every = int(value);
+        } else if (arg == "--pull" && hasValue) {
+            if (std::isnan(value = number(0.0))) {
+                return false;
+            }
+            options.pull = float(value);
+        } else if (arg == "--dt" && hasValue) {
+            if (std::isnan(value = number(1e-6))) {
+                return false;
+            }
+            options.dt = float(value);
+        } else if (arg == "--repeat" && hasValue) {
+            if (std::isnan(value = number(1.0))) {
+                return false;
+            }
+            options.repeat = int(value);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option or missing value: '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return false;
+        } else if (!tools::collectInputs(arg, options.inputs)) {
+            std::cerr << "Cannot read " << arg.substr(1) << std::endl;
+            return false;
+        }
+    }
+
+    if ((options.command == "convert" || options.command == "unfold") && options.outputDir.empty()) {
+        std::cerr << options.command << " needs an output directory (-o DIR)" << std::endl;
+        return false;
+    }
+    if (options.inputs.empty()) {
+        std::cerr << "No input files" << std::endl;
+        return false;
+    }
+    if ((options.command == "convert" || options.command == "unfold") &&
+        !checkStructureIds(options.inputs)) {
+        return false;
+    }
+    options.nestedThreads = parallel_nested_thread_count(options.inputs.size(), options.threads);
+    if (!options.outputDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(options.outputDir, ec);
+        if (ec) {
+            std::cerr << "Cannot create " << options.outputDir << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Loads one input on its share of the -j threads
+std::unique_ptr<pdb::Model> load(const fs::path& path, const Options& options,
+                                 pdb::ReaderOptions readerOptions = {}) {
+    readerOptions.maxThreads = options.nestedThreads;
+    auto model = pdb::loadCached(path.string(), readerOptions, "");
+    if (model && options.selector) {
+        model->removeAtoms(~options.selector->select(pdb::AtomTable(*model), options.nestedThreads));
+    }
+    return model;
+}
+
+// Runs process(path, line) over every input on the thread pool, then
+// prints the lines in input order. process returns false on a failure,
+// with line describing it.
+template <typename Process>
+int forEachInput(const Options& options, const Process& process) {
+    std::vector<std::string> lines(options.inputs.size());
+    std::vector<char> ok(options.inputs.size(), 0);
+    parallel_for(options.inputs.size(), [&](size_t i) {
+        ok[i] = process(options.inputs[i], lines[i]);
+    }, options.threads);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (ok[i]) {
+            std::cout << lines[i] << '\n';
+        } else {
+            std::cout.flush();
+            std::cerr << options.inputs[i].string() << ": " << lines[i] << '\n';
+            ++failed;
+        }
+    }
+    std::cout.flush();
+    if (failed > 0) {
+        std::cerr << failed << " of " << lines.size() << " inputs failed" << std::endl;
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+int runConvert(const Options& options) {
+    const char* extension = options.format == pdb::WriteFormat::Cif ? ".cif" : ".pdb";
+    return forEachInput(options, [&](const fs::path& path, std::string& line) {
+        auto model = load(path, options);
+        if (!model) {
+            line = "cannot parse";
+            return false;
+        }
+        fs::path output = fs::path(options.outputDir) / (tools::structureId(path) + extension);
+        pdb::Writer writer(output.string(), options.format);
+        if (!writer.write(*model) || !writer.close()) {
+            line = "cannot write " + output.string();
+            return false;
+        }
+        line = output.string();
+        return true;
+    });
+}
+
+int runStats(const Options& options) {
+    std::cout << "id\tatoms\thetatoms\tresidues\tchains\thelices\tstrands\tbonds\tperceived\n";
+    return forEachInput(options, [&](const fs::path& path, std::string& line) {
+        auto model = load(path, options);
+        if (!model) {
+            line = "cannot parse";
+            return false;
+        }
+        line = tools::structureId(path);
+        size_t bonds = pdb::BondGraph::fromModel(*model).bondCount();
+        size_t perceived = pdb::perceiveBonds(pdb::AtomTable(*model), 0.45f, options.nestedThreads).size();
+        for (size_t count : {model->atoms.size(), model->hetAtoms.size(), model->residues.size(),
+                             model->chainRanges.size(), model->helixes.size(), model->strands.size(),
+                             bonds, perceived}) {
+            line += '\t';
+            line += std::to_string(count);
+        }
+        return true;
+    });
+}
+
+int runUnfold(const Options& options) {
+    return forEachInput(options, [&](const fs::path& path, std::string& line) {
+        auto model = load(path, options, pdb::ReaderOptions::caTrace());
+        if (!model) {
+            line = "cannot parse";
+            return false;
+        }
+        UnfoldSim sim(*model);
+        if (sim.size() < 2) {
+            line = "fewer than two CA atoms";
+            return false;
+        }
+
+        // The starting conformation, then every options.every steps
+        fs::path output = fs::path(options.outputDir) / (tools::structureId(path) + "_unfold.pdb");
+        pdb::Writer writer(output.string(), pdb::WriteFormat::Pdb);
+        std::vector<pdb::Point> frame = pdb::positionsOf(*model);
+        bool written = writer.write(*model, frame);
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 1; written && step <= options.steps; ++step) {
+            sim.applyPulling(options.pull);
+            sim.step(options.dt);
+            if (step % options.every == 0 || step == options.steps) {
+                sim.copyPositions(frame);
+                written = writer.write(*model, frame);
+            }
+        }
+        if (!writer.close() || !written) {
+            line = "cannot write " + output.string();
+            return false;
+        }
+
+        std::vector<glm::vec3> ca = sim.getCAPositions();
+        char summary[160];
+        std::snprintf(summary, sizeof(summary), "%zu CA, %zu frames, end-to-end %.1f A, %.2f s",
+                      sim.size(), writer.models(), double(glm::distance(ca.front(), ca.back())),
+                      secondsSince(start));
+        line = output.string() + ": " + summary;
+        return true;
+    });
+}
+
+// Best of options.repeat runs of load(), in milliseconds; negative if it
+// fails
+template <typename Load>
+double bestTime(const Options& options, const Load& load) {
+    double best = -1.0;
+    for (int i = 0; i < options.repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<pdb::Model> model = load();
+        double ms = secondsSince(start) * 1e3;
+        if (!model) {
+            return -1.0;
+        }
+        best = best < 0.0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+// Timings are taken one file at a time so runs do not compete for cores;
+// each parse may use all -j threads
+int runBench(const Options& options) {
+    pdb::ReaderOptions readerOptions;
+    readerOptions.maxThreads = options.threads;
+    fs::path cacheDir = fs::temp_directory_path() /
+        ("foldgl-bench-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::cout << "id\tMB\tgetline_ms\tmmap_ms\tcache_ms\tmmap_MB/s" << std::endl;
+    size_t failed = 0;
+    for (const fs::path& path : options.inputs) {
+        std::string file = path.string();
+        MappedFile mapped(file);
+        if (!mapped.is_open()) {
+            std::cerr << file << ": cannot read" << std::endl;
+            ++failed;
+            continue;
+        }
+        double megabytes = double(mapped.size()) / (1 << 20);
+
+        // The istream reader only takes uncompressed PDB text
+        std::string_view head = mapped.view().substr(0, 4096);
+        bool pdbText = !is_gzip(head) && !pdb::isCif(head) && !pdb::isBinaryCif(head);
+        mapped.close();
+        double getlineMs = !pdbText ? -1.0 : bestTime(options, [&] {
+            std::ifstream in(file, std::ios::binary);
+            return pdb::Reader(in).read();
+        });
+        double mmapMs = bestTime(options, [&] { return pdb::loadCached(file, readerOptions, ""); });
+        pdb::loadCached(file, readerOptions, cacheDir.string());
+        double cacheMs = bestTime(options, [&] { return pdb::loadCached(file, readerOptions, cacheDir.string()); });
+        if (mmapMs < 0.0) {
+            std::cerr << file << ": cannot parse" << std::endl;
+            ++failed;
+            continue;
+        }
+
+        auto column = [](double value) {
+            char text[32];
+            std::snprintf(text, sizeof(text), value < 0.0 ? "-" : "%.3f", value);
+            return std::string(text);
+        };
+        std::cout << tools::structureId(path) << '\t' << column(megabytes) << '\t' << column(getlineMs)
+                  << '\t' << column(mmapMs) << '\t' << column(cacheMs) << '\t'
+                  << column(mmapMs > 0.0 ? megabytes / (mmapMs / 1e3) : 0.0) << std::endl;
+    }
+    std::error_code ec;
+    fs::remove_all(cacheDir, ec);
+    return failed > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (options.command == "convert") {
+        return runConvert(options);
+    }
+    if (options.command == "stats") {
+        return runStats(options);
+    }
+    if (options.command == "unfold") {
+        return runUnfold(options);
+    }
+    return runBench(options);
+}
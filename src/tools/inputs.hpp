@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Input handling shared by the command-line tools
+
+namespace tools {
+
+namespace fs = std::filesystem;
+
+// .pdb, .ent, .cif or .bcif, optionally followed by .gz
+inline bool isStructureFile(const fs::path& path) {
+    fs::path name = path.filename();
+    if (name.extension() == ".gz") {
+        name = name.stem();
+    }
+    std::string ext = name.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".pdb" || ext == ".ent" || ext == ".cif" || ext == ".bcif";
+}
+
+// File name without the compression and format extensions
+inline std::string structureId(const fs::path& path) {
+    fs::path name = path.filename();
+    if (name.extension() == ".gz") {
+        name = name.stem();
+    }
+    return name.stem().string();
+}
+
+// Adds argument's files: a directory is searched recursively for structure
+// files, "@list" reads one path per line from list, anything else is taken
+// as a file. Returns false if a list cannot be read.
+inline bool collectInputs(const std::string& argument, std::vector<fs::path>& files) {
+    if (argument.size() > 1 && argument[0] == '@') {
+        std::ifstream list(argument.substr(1));
+        if (!list) {
+            return false;
+        }
+        for (std::string line; std::getline(list, line);) {
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#') {
+                files.push_back(line);
+            }
+        }
+        return true;
+    }
+    std::error_code ec;
+    if (!fs::is_directory(argument, ec)) {
+        files.push_back(argument);
+        return true;
+    }
+    size_t first = files.size();
+    for (fs::recursive_directory_iterator it(argument, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && isStructureFile(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    std::sort(files.begin() + first, files.end());
+    return true;
+}
+
+} // namespace tools
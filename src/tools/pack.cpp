@@ -0,0 +1,97 @@
+// foldgl-pack: parses a directory of structure files in parallel and packs
+// the models into one archive (.fgla) for random access.
+//
+//   foldgl-pack <output.fgla> <directory|file|@list>...
+//
+// Directories are searched recursively for .pdb, .ent, .cif and .bcif
+// files, optionally gzip-compressed. Each structure is stored under its file
+// name without extensions, e.g. "pdb1abc" for pdb1abc.ent.gz. "@list"
+// arguments name a file with one input path per line.
+#include "pdb/archive.hpp"
+#include "pdb/cache.hpp"
+#include "utils/parallel.hpp"
+#include "tools/inputs.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Files parsed per worker thread in each round; items are added in input
+// order between rounds, so the output does not depend on thread timing and
+// only one round of models is held in memory
+constexpr size_t kFilesPerThread = 4;
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output.fgla> <directory|file|@list>..." << std::endl;
+        return 1;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<fs::path> files;
+    for (int i = 2; i < argc; ++i) {
+        if (!tools::collectInputs(argv[i], files)) {
+            std::cerr << "Cannot read " << argv[i] + 1 << std::endl;
+            return 1;
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    pdb::ArchiveWriter writer(argv[1]);
+    if (!writer.is_open()) {
+        std::cerr << "Cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+
+    size_t batch = parallel_thread_count(files.size()) * kFilesPerThread;
+    // Each worker parses on its share of the cores
+    pdb::ReaderOptions readerOptions;
+    readerOptions.maxThreads = parallel_nested_thread_count(files.size());
+    size_t failed = 0;
+    std::vector<pdb::ArchiveItem> items;
+    std::vector<char> parsed;
+    for (size_t first = 0; first < files.size(); first += batch) {
+        size_t count = std::min(batch, files.size() - first);
+        items.assign(count, pdb::ArchiveItem{});
+        parsed.assign(count, 0);
+        parallel_for(count, [&](size_t i) {
+            const fs::path& path = files[first + i];
+            auto model = pdb::loadCached(path.string(), readerOptions, "");
+            parsed[i] = model && pdb::ArchiveWriter::prepare(tools::structureId(path), *model, items[i]);
+        });
+
+        for (size_t i = 0; i < count; ++i) {
+            const fs::path& path = files[first + i];
+            if (!parsed[i]) {
+                std::cerr << "Skipping " << path.string() << ": cannot parse" << std::endl;
+                ++failed;
+            } else if (!writer.add(items[i])) {
+                if (!writer.is_open()) {
+                    std::cerr << "Write error on " << argv[1] << std::endl;
+                    return 1;
+                }
+                std::cerr << "Skipping " << path.string() << ": duplicate ID "
+                          << items[i].id << std::endl;
+                ++failed;
+            }
+        }
+    }
+
+    if (!writer.finish()) {
+        std::cerr << "Write error on " << argv[1] << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Packed " << writer.size() << " structures into " << argv[1]
+              << " in " << seconds << " s";
+    if (failed > 0) {
+        std::cout << " (" << failed << " skipped)";
+    }
+    std::cout << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "gzip_stream.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+namespace {
+
+// Spin briefly, then yield, then sleep while the other side catches up
+void backoff(size_t& spins)
+{
+    ++spins;
+    if (spins < 64)
+        return;
+    if (spins < 1024)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+} // namespace
+
+bool is_gzip(std::string_view data)
+{
+    return data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+           static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+GzipStreamBuf::GzipStreamBuf(std::string_view compressed)
+    : compressed_(compressed)
+{
+    for (auto& chunk : chunks_)
+        chunk.data.resize(kChunkSize);
+    setg(nullptr, nullptr, nullptr);
+    producer_ = std::thread(&GzipStreamBuf::produce, this);
+}
+
+GzipStreamBuf::~GzipStreamBuf()
+{
+    stop_.store(true, std::memory_order_relaxed);
+    producer_.join();
+}
+
+std::string_view GzipStreamBuf::peek_chunk()
+{
+    if (gptr() == egptr() && underflow() == traits_type::eof())
+        return std::string_view();
+    return std::string_view(gptr(), egptr() - gptr());
+}
+
+GzipStreamBuf::int_type GzipStreamBuf::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    // Hand the chunk just read back to the producer
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (holding_) {
+        tail_.store(++tail, std::memory_order_release);
+        holding_ = false;
+    }
+
+    size_t spins = 0;
+    while (head_.load(std::memory_order_acquire) == tail) {
+        // done_ is set after the last chunk is published, so recheck head_
+        if (done_.load(std::memory_order_acquire) &&
+            head_.load(std::memory_order_acquire) == tail) {
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        backoff(spins);
+    }
+
+    Chunk& chunk = chunks_[tail % kChunkCount];
+    char* begin = chunk.data.data();
+    setg(begin, begin, begin + chunk.size);
+    holding_ = true;
+    return traits_type::to_int_type(*begin);
+}
+
+void GzipStreamBuf::produce()
+{
+    z_stream zs{};
+    bool failed = inflateInit2(&zs, 15 + 16) != Z_OK;  // gzip header and trailer
+    bool ended = false;
+    size_t offset = 0;  // Compressed bytes handed to zlib so far
+    size_t head = 0;
+
+    while (!failed && !ended && !stop_.load(std::memory_order_relaxed)) {
+        // Wait for a free chunk
+        size_t spins = 0;
+        while (head - tail_.load(std::memory_order_acquire) == kChunkCount &&
+               !stop_.load(std::memory_order_relaxed))
+            backoff(spins);
+        if (stop_.load(std::memory_order_relaxed))
+            break;
+
+        Chunk& chunk = chunks_[head % kChunkCount];
+        chunk.size = 0;
+        while (chunk.size < kChunkSize && !failed && !ended) {
+            if (zs.avail_in == 0) {
+                if (offset == compressed_.size()) {
+                    failed = true;  // Truncated: input ran out mid-stream
+                    break;
+                }
+                size_t take = std::min<size_t>(compressed_.size() - offset, UINT_MAX);
+                zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed_.data() + offset));
+                zs.avail_in = static_cast<uInt>(take);
+                offset += take;
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(chunk.data.data() + chunk.size);
+            zs.avail_out = static_cast<uInt>(kChunkSize - chunk.size);
+            int rc = inflate(&zs, Z_NO_FLUSH);
+            chunk.size = kChunkSize - zs.avail_out;
+            if (rc == Z_STREAM_END) {
+                // Another gzip member may follow
+                if (zs.avail_in == 0 && offset == compressed_.size())
+                    ended = true;
+                else if (inflateReset(&zs) != Z_OK)
+                    failed = true;
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                failed = true;
+            }
+        }
+        if (chunk.size > 0)
+            head_.store(++head, std::memory_order_release);
+    }
+
+    inflateEnd(&zs);
+    failed_.store(failed, std::memory_order_release);
+    done_.store(true, std::memory_order_release);
+}
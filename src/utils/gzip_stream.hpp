@@ -0,0 +1,94 @@
+#if !defined(GZIP_STREAM_H)
+#define GZIP_STREAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Returns true if @p data starts with the gzip magic bytes (1f 8b).
+ */
+bool is_gzip(std::string_view data);
+
+/**
+ * @brief Stream buffer that inflates gzip data on a background thread.
+ *
+ * A producer thread inflates the input into a ring of fixed-size chunks
+ * handed to the reader through a lock-free single-producer/single-consumer
+ * queue, so decompression runs while the previous chunk is being parsed.
+ * Concatenated gzip members are read back to back. The compressed bytes
+ * must outlive the buffer.
+ */
+class GzipStreamBuf : public std::streambuf {
+public:
+    static constexpr size_t kChunkSize = size_t(1) << 20;
+    static constexpr size_t kChunkCount = 8;
+
+    explicit GzipStreamBuf(std::string_view compressed);
+    ~GzipStreamBuf() override;
+
+    GzipStreamBuf(const GzipStreamBuf&) = delete;
+    GzipStreamBuf& operator=(const GzipStreamBuf&) = delete;
+
+    /**
+     * @brief Returns the decompressed bytes buffered for reading, waiting
+     *        for the first chunk if needed. Nothing is consumed.
+     *
+     * @return std::string_view Empty at the end of the data.
+     */
+    std::string_view peek_chunk();
+
+    /**
+     * @brief False once the producer has hit corrupt or truncated input.
+     */
+    bool ok() const { return !failed_.load(std::memory_order_acquire); }
+
+protected:
+    int_type underflow() override;
+
+private:
+    struct Chunk {
+        std::vector<char> data;
+        size_t size = 0;
+    };
+
+    void produce();
+
+    std::string_view compressed_;
+    std::array<Chunk, kChunkCount> chunks_;
+    // head_ counts chunks published by the producer, tail_ counts chunks
+    // the reader has finished with; chunk i lives in chunks_[i % kChunkCount]
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<bool> done_{false};
+    std::atomic<bool> failed_{false};
+    std::atomic<bool> stop_{false};
+    bool holding_ = false;  // Get area points into chunk tail_
+    std::thread producer_;
+};
+
+/**
+ * @brief std::istream that reads gzip-compressed bytes through a
+ *        GzipStreamBuf.
+ */
+class GzipStream : public std::istream {
+public:
+    explicit GzipStream(std::string_view compressed)
+        : std::istream(nullptr), buffer_(compressed)
+    {
+        rdbuf(&buffer_);
+    }
+
+    GzipStreamBuf& buffer() { return buffer_; }
+    bool ok() const { return buffer_.ok(); }
+
+private:
+    GzipStreamBuf buffer_;
+};
+
+#endif // GZIP_STREAM_H
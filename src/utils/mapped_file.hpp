@@ -0,0 +1,45 @@
+#if !defined(MAPPED_FILE_H)
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The mapping is released when the object is destroyed. Views returned by
+ * view() stay valid only as long as the MappedFile they came from.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Maps the file at @p path, replacing any previous mapping.
+     *
+     * @return bool true on success. An empty file maps successfully to an
+     *              empty view.
+     */
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return open_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,199 @@
+#if !defined(PARALLEL_H)
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel_detail {
+
+/**
+ * @brief Worker threads shared by every parallel_for call.
+ *
+ * Workers are started on first use and sleep between calls. A call posts a
+ * Job and runs it on the calling thread too; idle workers join it until it
+ * has as many helpers as it asked for. A call nested inside a task only
+ * gets workers that are idle at the time, so nesting never waits on busy
+ * workers and cannot deadlock.
+ */
+class Pool
+{
+public:
+    struct Job {
+        std::function<void()> run;  // Claims and runs tasks until none are left
+        size_t wanted{0};           // Helpers still to join
+        size_t active{0};           // Helpers running run()
+    };
+
+    static Pool& instance()
+    {
+        static Pool pool;
+        return pool;
+    }
+
+    /// Offers job to up to job.wanted workers, starting workers as needed
+    void post(Job& job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (workers_.size() < job.wanted)
+            workers_.emplace_back([this]() { work(); });
+        jobs_.push_back(&job);
+        if (job.wanted == 1)
+            wake_.notify_one();
+        else
+            wake_.notify_all();
+    }
+
+    /// Withdraws job and waits until every helper has left it
+    void finish(Job& job)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = std::find(jobs_.begin(), jobs_.end(), &job);
+        if (it != jobs_.end())
+            jobs_.erase(it);
+        done_.wait(lock, [&job]() { return job.active == 0; });
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+private:
+    Pool() = default;
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+            if (stop_)
+                return;
+            Job* job = jobs_.front();
+            ++job->active;
+            if (--job->wanted == 0)
+                jobs_.pop_front();
+            lock.unlock();
+            job->run();
+            lock.lock();
+            if (--job->active == 0)
+                done_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::deque<Job*> jobs_;
+    std::vector<std::thread> workers_;
+    bool stop_{false};
+};
+
+} // namespace parallel_detail
+
+/**
+ * @brief Returns how many worker threads to use for @p tasks independent tasks.
+ *
+ * @param tasks       Number of tasks that can run concurrently.
+ * @param max_threads Upper bound on the thread count. 0 means one thread per
+ *                    hardware core.
+ */
+inline size_t parallel_thread_count(size_t tasks, size_t max_threads = 0)
+{
+    size_t threads = max_threads;
+    if (threads == 0)
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(threads, tasks));
+}
+
+/**
+ * @brief Returns the thread budget for parallel work nested inside
+ *        parallel_for(@p tasks, fn, @p max_threads).
+ *
+ * Each outer worker gets an equal share of the threads, at least one, so
+ * nested parallel_for calls do not multiply the thread count.
+ *
+ * @param tasks       Number of tasks of the outer loop.
+ * @param max_threads Upper bound on the outer loop's thread count. 0 means
+ *                    one thread per hardware core.
+ */
+inline size_t parallel_nested_thread_count(size_t tasks, size_t max_threads = 0)
+{
+    size_t threads = max_threads;
+    if (threads == 0)
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, threads / parallel_thread_count(tasks, max_threads));
+}
+
+/**
+ * @brief Calls fn(i) for every i in [0, count) on a persistent pool of
+ *        worker threads.
+ *
+ * Tasks are handed out one index at a time, so uneven task sizes balance
+ * across workers. The calling thread takes part in the work, and workers
+ * that are busy elsewhere (e.g. in an enclosing parallel_for) are not
+ * waited for. If a task throws, remaining tasks are skipped and the first
+ * exception is rethrown once all workers have stopped.
+ *
+ * @param count       Number of tasks.
+ * @param fn          Callable taking a size_t task index.
+ * @param max_threads Upper bound on the thread count. 0 means one thread per
+ *                    hardware core.
+ */
+template <typename Fn>
+void parallel_for(size_t count, Fn&& fn, size_t max_threads = 0)
+{
+    size_t threads = parallel_thread_count(count, max_threads);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count)
+                break;
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    parallel_detail::Pool& pool = parallel_detail::Pool::instance();
+    parallel_detail::Pool::Job job;
+    job.run = worker;
+    job.wanted = threads - 1;
+    pool.post(job);
+    worker();
+    pool.finish(job);
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+#endif // PARALLEL_H